@@ -98,6 +98,7 @@
 
 // #include "grounder.h"
 #include "Timer.h"
+#include "tokenizer.h"
 
 
 /////////////////////////////////////////////////////////////////////////////////////////////
@@ -645,47 +646,20 @@ bool read_uint32_vec_extension(string extStr,T & extension) {
 
 bool
 read_mpz_extension(string extStr, mpz_class *  intExt) {
-    char pch_str[extStr.size()+1];
-    char * pch;
+    // Same delimiters strtok used to be given, plus line breaks and tabs
+    static const DelimiterSet extDelimiters(" ,:[]\n\r\t");
+    TokenStream tokens(extStr, extDelimiters);
     string nodeID;
-    // if (extStr.size() > max_ext_length) {
-    //   cout << "Houston we have a problem!" << endl;
-    //   cout << "Reserved " << extStr.size()+1 << " characters" << endl;
-    //   cout << "This extension is " << extStr.size() << " chars long!" <<endl;
-    //   exit(0);
-    // };
-    strcpy(pch_str, extStr.c_str());
-    pch = strtok(pch_str, " ,:[]");
     IntArgId_T thisBit;
-    if (pch != NULL) {
-        nodeID = string(pch);
+    string_view token = tokens.next();
+    while (!token.empty()) {
+        nodeID.assign(token.data(), token.size());
         if (intArgId.find(nodeID)==intArgId.end()) {
             intArgId[nodeID]=intArgId.size();
         };
-        thisBit=getIntArgId(nodeID);
+        thisBit=getIntArgId(nodeID); // 0 was reserved for nullIntArgId
         mpz_setbit(intExt->get_mpz_t(),thisBit);
-        pch = strtok(NULL, " ,:[]");
-        // mpz_t integ, bit;
-        // mpz_init2(integ,100);
-        // mpz_init2(bit,100);			 
-        while (pch != NULL) {
-            nodeID = string(pch);
-            if (intArgId.find(nodeID)==intArgId.end()) {
-                intArgId[nodeID]=intArgId.size();
-            };
-            thisBit=getIntArgId(nodeID); // 0 was reserved for nullIntArgId
-            // cout << "thisBit: " << thisBit << endl;
-            mpz_setbit(intExt->get_mpz_t(),thisBit);
-            // if (thisBit > 999998) {
-            // 	cout << "Limbs allocated: ";
-            // 	cout << intExt->get_mpz_t()->_mp_alloc << endl;
-            // 	cout << "Bytes allocated: ";
-            // 	cout << intExt->get_mpz_t()->_mp_alloc * (mp_bits_per_limb/8) << " bytes" << endl;
-            // };
-            pch = strtok(NULL, " ,:[]");
-        };
-        // std::cout << intExt->get_mpz_t() << "-->" << intExt->get_str(2) << std::endl; //base 2 representation
-        return true;
+        token = tokens.next();
     };
     return true;
 }
@@ -16,12 +16,29 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <chrono>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <system_error>
+#include <functional>
+#include <limits>
+#include <string_view>
+#include <cstring>
+#include <csignal>
 #include "util.h"
 #include "graph.h"
 #include "opts.h"
 #include "graphhashset.h"
 #include "persistentargs.h"
-#include "pstream.h"
+#include "extensionset.h"
+#include "coreslots.h"
+#include "runtimeestimator.h"
+#include "semanticverifier.h"
+#include "grounded.h"
+#include "compressedfile.h"
+#include "processlauncher.h"
 #include "date.h"
 
 #ifndef CONF_PATH
@@ -34,7 +51,316 @@
 namespace po = boost::program_options;
 namespace fs = std::filesystem;
 
-const int magic_number = 143; //randomly selected, used as special return value
+
+//One solver run: a problem on a graph, with everything needed to run it worked out beforehand
+struct BenchmarkJob
+{
+    std::string graphFile;
+    std::string hash;
+    std::string fullproblem; //as given, e.g. DC-PR:5
+    std::string problem; //as passed to the solver, e.g. DC-PR
+    std::string additionalArg;
+    fs::path outfp; //solver output
+    fs::path resfp; //runsolver's and our statistics
+    fs::path solfp; //reference solution
+    double predictedSeconds = -1; //-1 if unknown
+    std::uintmax_t graphBytes = 0;
+};
+
+//Writes one message while holding a lock shared by every message, so that lines from concurrent jobs
+//don't get mixed up
+class Report
+{
+    public:
+        Report(std::ostream& os) : guard(lock), os(os) {}
+        template <typename T> Report& operator<<(const T& value) { os << value; return *this; }
+        Report& operator<<(std::ostream& (*manipulator)(std::ostream&)) { os << manipulator; return *this; }
+    private:
+        static std::mutex lock;
+        std::lock_guard<std::mutex> guard;
+        std::ostream& os;
+};
+std::mutex Report::lock;
+
+//Runs a program to completion, with its standard output sent to outFd if given, and returns its wait status,
+//or -1 if it couldn't be reaped. Throws std::system_error if it can't be started.
+int runProgram(const std::vector<std::string>& argv, int outFd = -1)
+{
+    ProcessLauncher launcher(argv);
+    if (outFd >= 0)
+    {   launcher.redirect(STDOUT_FILENO, outFd);
+    }
+    return ProcessLauncher::wait(launcher.start());
+}
+
+//As above, but with the program's standard output read through a pipe and handed to onOutput as it arrives;
+//onOutput mustn't throw, or the program could be left blocked on a full pipe. The program is started on the
+//calling thread's CPUs, but its output is read on readerCpus if there are any, so that handling it doesn't
+//take CPU time from the program.
+int runProgram(const std::vector<std::string>& argv, const std::function<void(std::string_view)>& onOutput,
+    const CoreSlot& readerCpus)
+{
+    int fds[2];
+    if (pipe2(fds, O_CLOEXEC) < 0)
+    {   throw std::system_error(errno, std::generic_category(), "Unable to create pipe for " + argv[0]);
+    }
+    pid_t pid;
+    try
+    {   ProcessLauncher launcher(argv);
+        launcher.redirect(STDOUT_FILENO, fds[1]);
+        pid = launcher.start();
+    }
+    catch (...)
+    {   close(fds[0]);
+        close(fds[1]);
+        throw;
+    }
+    close(fds[1]);
+
+    std::unique_ptr<TemporaryPinning> pinning;
+    if (!readerCpus.cpus.empty())
+    {   try
+        {   pinning = std::make_unique<TemporaryPinning>(readerCpus);
+        }
+        catch (std::system_error&)
+        {   kill(pid, SIGKILL);
+            close(fds[0]);
+            ProcessLauncher::wait(pid);
+            throw;
+        }
+    }
+
+    std::vector<char> buffer(1 << 16);
+    for (ssize_t n; (n = read(fds[0], buffer.data(), buffer.size())) != 0; )
+    {   if (n > 0)
+        {   onOutput(std::string_view(buffer.data(), n));
+        }
+        else if (errno != EINTR)
+        {   break;
+        }
+    }
+    close(fds[0]);
+    return ProcessLauncher::wait(pid);
+}
+
+//A solver's output, as it arrives through a pipe, only written to its file if it might be kept: it's held in
+//memory up to a point, written out past that, and dropped altogether once it's larger than any output that's
+//kept. Whether to keep it is only decided once it's been checked, with keep() or discard(). If compressed, it's
+//written through a CompressedWriter; keepLimit is of the output itself either way.
+class OutputSink
+{
+    public:
+        static constexpr size_t memoryLimit = 64 << 20;
+
+        OutputSink(const fs::path& file, std::uintmax_t keepLimit, bool compressed)
+            : file(file), keepLimit(keepLimit), compressed(compressed) {}
+        ~OutputSink()
+        {   if (fd >= 0)
+            {   close(fd);
+            }
+        }
+        void write(std::string_view chunk)
+        {   bytes += chunk.size();
+            if (dropped || failed)
+            {   return;
+            }
+            if (bytes > keepLimit)
+            {   dropped = true;
+                std::string().swap(buffer);
+                return;
+            }
+            if (fd < 0 && !writer && buffer.size() + chunk.size() <= std::min<std::uintmax_t>(keepLimit, memoryLimit))
+            {   buffer.append(chunk);
+                return;
+            }
+            failed = !(writeOut(buffer) && writeOut(chunk));
+            std::string().swap(buffer);
+        }
+        std::uintmax_t size() const { return bytes; }
+        //False if it was too large to keep or couldn't be written, with error() saying which
+        bool keep()
+        {   if (dropped)
+            {   fail(file.string() + " is too large to keep");
+            }
+            bool kept = !failed && writeOut(buffer);
+            if (fd >= 0)
+            {   if (close(fd) != 0)
+                {   fail("Unable to write " + file.string() + ": " + std::strerror(errno));
+                }
+                kept = !failed && kept;
+                fd = -1;
+            }
+            if (writer)
+            {   if (!writer->close())
+                {   fail("Unable to write " + writer->error());
+                }
+                kept = !failed && kept;
+                writer.reset();
+            }
+            return kept;
+        }
+        const std::string& error() const { return failure; } //empty if nothing failed
+        //The file is removed even if nothing was written to it, as it might be left from a previous run
+        void discard()
+        {   if (fd >= 0)
+            {   close(fd);
+                fd = -1;
+            }
+            writer.reset();
+            std::error_code ec;
+            fs::remove(file, ec);
+        }
+    private:
+        //The reason is recorded where it happens, as errno won't last until it's reported
+        bool writeOut(std::string_view data)
+        {   if (compressed)
+            {   try
+                {   if (!writer)
+                    {   writer = std::make_unique<CompressedWriter>(file);
+                    }
+                }
+                catch (std::runtime_error& e)
+                {   fail(e.what());
+                    return false;
+                }
+                if (!writer->write(data))
+                {   fail("Unable to write " + writer->error());
+                    return false;
+                }
+                return true;
+            }
+            if (fd < 0)
+            {   fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                if (fd < 0)
+                {   fail("Unable to create " + file.string() + ": " + std::strerror(errno));
+                    return false;
+                }
+            }
+            while (!data.empty())
+            {   ssize_t n = ::write(fd, data.data(), data.size());
+                if (n < 0 && errno != EINTR)
+                {   fail("Unable to write " + file.string() + ": " + std::strerror(errno));
+                    return false;
+                }
+                data.remove_prefix(std::max<ssize_t>(n, 0));
+            }
+            return true;
+        }
+
+        fs::path file;
+        std::uintmax_t keepLimit;
+        bool compressed;
+        std::unique_ptr<CompressedWriter> writer;
+        std::uintmax_t bytes = 0;
+        std::string buffer;
+        int fd = -1;
+        bool dropped = false; //too large to keep
+        bool failed = false; //couldn't be written
+        std::string failure;
+
+        void fail(const std::string& message)
+        {   if (!failed)
+            {   failure = message;
+            }
+            failed = true;
+        }
+};
+
+//Checks a solver's output against the reference solution as it arrives, just as a whole output file is checked:
+//as a decision if its first word is YES or NO (whitespace is skipped throughout and the word ends at anything
+//else that isn't a letter), else as extensions. Only once the first word is known is the reference loaded as
+//extensions, and then only if needed.
+class StreamedComparison
+{
+    public:
+        StreamedComparison(const fs::path& solfp, const fs::path& outfp) : solfp(solfp), outfp(outfp) {}
+        //Errors are kept for finish(), so that the output goes on being read
+        void feed(std::string_view chunk)
+        {   try
+            {   if (!error.empty())
+                {   return;
+                }
+                else if (extensions)
+                {   extensions->feed(chunk);
+                    return;
+                }
+                else if (wordComplete)
+                {   return; //a decision
+                }
+                for (size_t i = 0; i < chunk.size() && !wordComplete; i++)
+                {   unsigned char c = chunk[i];
+                    if (std::isalpha(c))
+                    {   word += c;
+                        wordComplete = (word.size() > 3); //too long to be YES or NO, which is all that matters
+                    }
+                    else if (!std::isspace(c))
+                    {   wordComplete = true;
+                    }
+                }
+                prefix.append(chunk);
+                if (wordComplete)
+                {   startExtensions();
+                }
+            }
+            catch (std::exception& e)
+            {   error = e.what();
+            }
+        }
+        //Throws std::runtime_error if the output or the reference couldn't be read
+        ExtensionComparison finish()
+        {   if (error.empty() && !wordComplete)
+            {   wordComplete = true;
+                startExtensions();
+            }
+            if (!error.empty())
+            {   throw std::runtime_error(error);
+            }
+            else if (!extensions)
+            {   return { readFirstLine(solfp) == word, 0, 0, 0 };
+            }
+            return extensions->finish();
+        }
+    private:
+        void startExtensions()
+        {   try
+            {   if (word != "YES" && word != "NO")
+                {   reference = std::make_unique<ExtensionSet>(ExtensionSet::loadReference(solfp));
+                    extensions = std::make_unique<ExtensionStream>(*reference, outfp);
+                    extensions->feed(prefix);
+                }
+            }
+            catch (std::exception& e)
+            {   error = e.what();
+            }
+            std::string().swap(prefix);
+        }
+
+        fs::path solfp, outfp;
+        std::string word;
+        bool wordComplete = false;
+        std::string prefix; //the output until the first word is known
+        std::unique_ptr<ExtensionSet> reference;
+        std::unique_ptr<ExtensionStream> extensions;
+        std::string error;
+};
+
+//Stores a reference solution compressed - for enumeration problems if binary, encoded first - unless it already
+//is or is too small to gain from it; false if it couldn't be. Solutions that can't be encoded are just compressed.
+bool storeSolution(const fs::path& solfp, const std::string& problem, bool binary)
+{
+    const std::uintmax_t minStoredSize = 4096;
+    if (fs::file_size(solfp) < minStoredSize)
+    {   return true;
+    }
+    if (binary && problem.compare(0, 3, "EE-") == 0)
+    {   try
+        {   ExtensionSet::encode(solfp);
+        }
+        catch (std::runtime_error& e)
+        { }
+    }
+    return compressFile(solfp);
+}
 
 unsigned long getSizeInBytes(std::string sizeWithSuffix)
 {
@@ -96,7 +422,17 @@ int main(int argc, char** argv)
         ("save-correct-max-size,M", po::value<std::string>(), "Maximum size below which fully correct solutions will be saved to disk. Must be lower than --save-max-size. Only applies if the --save-all option is also set. As above, defaults to MiB and suffixes can be used to determine units. Unlimited by default.\n")
         ("time-limit,t", po::value<int>(), "Timeout (in seconds).\n")
         ("memory-limit,T", po::value<int>(), "Soft limit for memory (in megabytes).\n")
-        ("problems,p", po::value<std::vector<std::string>>()->composing()->multitoken(), "A list of problems to be solved on all input graphs.\n");
+        ("compare-memory", po::value<std::string>()->default_value("1024"), "Solutions to enumeration problems whose reference and output add up to more than this are checked out of memory, through sorted temporary files next to the output, holding about this much in memory at a time (per job). Units as for --save-max-size.\n")
+        ("problems,p", po::value<std::vector<std::string>>()->composing()->multitoken(), "A list of problems to be solved on all input graphs.\n")
+        ("cores-per-job", po::value<unsigned>()->default_value(1), "Number of CPUs dedicated to each solver run. Runs in parallel never share a CPU, and physical cores are used up before their hyperthreads, so on machines with hyperthreading, 2 gives each run a whole physical core once --jobs is high enough to use every core. With --jobs 0, as many runs as fit on the available CPUs are made at once.\n")
+        ("input-order", po::bool_switch(), "Run the jobs graph by graph, in the order the graphs are listed. By default, the jobs expected to take longest are run first, so that interrupted runs resumed with --recover lose the least work, and parallel runs (see --jobs) don't end up waiting on a few large instances started last. Expected times come from previous runs of the solver on the same graph and problem or, failing that, from the Size, Sparseness and SCC-Count scores of the graph (see graph_analyser); jobs with neither are run first, largest graph files first.\n")
+        ("numa", po::bool_switch(), "Keep each solver run within a single NUMA node, both its CPUs and its memory, spreading runs across the nodes.\n")
+        ("no-native-grounded", po::bool_switch(), "Use the reference solver for grounded-semantics problems (DC-GR, DS-GR, SE-GR, EE-GR and CE-GR) too. By default, their reference solutions are worked out by benchmarker itself, in linear time, so they need no reference solver.\n")
+        ("stream-output", po::bool_switch(), "Read the solver's output through a pipe and check it as it arrives, against the reference solution and the graph, rather than have runsolver write it to the .output file and read it back. It's then only written out if it's kept (see --save-all, --save-max-size and --save-correct-max-size); the first 64 MiB are held in memory meanwhile, so that smaller outputs that aren't kept are never written at all, and once an output is larger than any that would be kept, it's no longer written. Setting --save-max-size saves the most. Jobs whose reference solution is larger than --compare-memory are run as usual. When jobs are pinned to CPUs (see --jobs), outputs are read and checked on CPUs outside every job's slot, so as not to take CPU time from the solvers; if there are none to spare, one slot is given over to it, and with only one slot, this option is refused.\n")
+        ("compress-outputs", po::bool_switch(), "Store the solver outputs that are kept gzip-compressed, under their usual names (zcat reads them). Sizes given to --save-max-size and --save-correct-max-size are still those of the output itself.\n")
+        ("solution-format", po::value<std::string>()->default_value("text"), "How reference solutions are stored in the store: \"text\", as output by the reference solver; \"gzip\", compressed; or \"binary\", in which solutions to EE problems are stored as their extensions, sorted and encoded (with the names of their arguments), and the rest compressed as with gzip. Solutions of a few KiB or less are always left as text. Solutions already in the store are converted when next used. Every format can be read whatever this is set to.\n")
+        ("no-verify", po::bool_switch(), "Do not check the extensions output for admissible, complete and stable semantics (by EE and SE problems, and as witnesses after YES for DC and NO for DS) against the graph itself. By default they are, and the number that are valid and invalid recorded in the .stat file, as VALIDEXTS and INVALIDEXTS, with the positions of the first few invalid ones as INVALIDEXTINDICES. Such problems are then also benchmarked when there is neither a reference solution nor a reference solver, with only this check.\n");
+    addJobsOpts(allSrcs, "solver runs (each pinned to its own CPUs)");
     addQuietVerboseOpts(allSrcs);
 
     po::options_description cmdOpts;
@@ -172,7 +508,16 @@ int main(int argc, char** argv)
 
     bool quiet = opts["quiet"].as<bool>();
     bool verbose = opts["verbose"].as<bool>();
-    bool useHashCache = opts["use-hash-cache"].as<bool>();
+    bool useHashCache = !opts["no-hash-cache"].as<bool>();
+    bool verifyOutput = !opts["no-verify"].as<bool>();
+    bool nativeGrounded = !opts["no-native-grounded"].as<bool>();
+    bool streamOutput = opts["stream-output"].as<bool>();
+    bool compressOutputs = opts["compress-outputs"].as<bool>();
+    std::string solutionFormat = opts["solution-format"].as<std::string>();
+    if (solutionFormat != "text" && solutionFormat != "gzip" && solutionFormat != "binary")
+    {   std::cout << "ERROR: Unknown solution format " << solutionFormat << "; expected text, gzip or binary. Terminating." << std::endl;
+        return 1;
+    }
     bool recover = opts["recover"].as<bool>();
     bool clobber = opts["clobber"].as<bool>();
     bool saveAll = opts["save-all"].as<bool>();
@@ -193,6 +538,7 @@ int main(int argc, char** argv)
     {   std::string sms = opts["save-max-size"].as<std::string>();
         saveMaxSize = getSizeInBytes(sms);
     }
+    std::uintmax_t compareMemory = getSizeInBytes(opts["compare-memory"].as<std::string>());
     std::uintmax_t saveCorrectMaxSize = 0;
     if (!opts["save-correct-max-size"].empty())
     {   std::string scms = opts["save-correct-max-size"].as<std::string>();
@@ -217,7 +563,7 @@ int main(int argc, char** argv)
     {   std::cout << "INFO: No solver binary specified. No benchmarks will be ran; the reference solver will be used to generate any solutions that don't already exist." << std::endl;
     }
     else if (referenceSolverpath == "" && verbose)
-    {   std::cout << "INFO: No reference solver specified; benchmarks will only be ran against graph+problem combinations for which a reference solution has previously been generated." << std::endl;
+    {   std::cout << "INFO: No reference solver specified; benchmarks will only be ran against graph+problem combinations for which a reference solution has previously been generated, or whose output can be verified against the graph itself (see --no-verify)." << std::endl;
     }
 
     fs::path solverexecpath(solverpath);
@@ -229,38 +575,43 @@ int main(int argc, char** argv)
         fs::remove_all(runIdDir);
     }
 
-    std::set<std::string> graphFiles = get_graphset();
-    GraphHashSet ghset;
+    std::set<std::string> graphSet = get_graphset();
+    std::vector<std::string> graphFiles(graphSet.begin(), graphSet.end());
+    GraphHashSet ghset(opts["use-hash-cache"].as<bool>());
     PersistentArgs argCache;
-    //For each graph, parse it to get the hash, then loop over problems
-        //For each problem:
-            //If "recover" flag was set, check if there's already a result with this run ID; if there is, continue; if not, or recover isn't set:
-            //Check if there's a solution. If not, and a reference solver was specified, invoke it; otherwise print a warning and skip.
-            //Now that a solution exists, run the benchmarked solver. Get results. Depending on options, save to disk.
-            //Compare results here, generate correctness, save to disk.
-
-    /******** Loop over graphs ********/
-    for (std::string graphFile : graphFiles)
-    {   //First, get the hash of the graph
-        if (!quiet)
-        {   std::cout << "Starting to process graph " << graphFile << std::endl;
-        }
-        std::string currHash;
-        if (useHashCache && ghset.exists(graphFile))
-        {   currHash = ghset.getHash(graphFile);
-        }
-        else
-        {   std::unique_ptr<Graph> graphPtr = std::unique_ptr<Graph>(parseFile(graphFile));
-            if (!graphPtr)
-            {   std::cerr << "ERROR: Error parsing graph file " << graphFile << ". Skipping." << std::endl;
-                continue;
-            }
-            currHash = graphPtr->hash();
-            ghset.setHash(graphFile, currHash);
-            if (verbose)
-            {   std::cout << "    Loaded graph " << graphFile << std::endl;
-            }
 
+    //hash every graph up front (this isn't what is being benchmarked, so all cores are used), so that
+    //each distinct graph is only solved once however many files hold it
+    std::vector<std::string> hashes = hashGraphs(graphFiles, ghset, useHashCache, 0);
+    std::vector<UniqueGraph> uniqueGraphs = dedupeGraphs(graphFiles, hashes);
+    size_t duplicateCount = 0;
+    for (const UniqueGraph& g : uniqueGraphs)
+    {   duplicateCount += g.duplicates.size();
+    }
+    if (duplicateCount > 0 && !quiet)
+    {   std::cout << "INFO: " << uniqueGraphs.size() + duplicateCount << " graph files hold " << uniqueGraphs.size() << " distinct graphs: skipping "
+            << duplicateCount << " duplicate file(s), saving up to " << duplicateCount * problems.size() << " solver run(s). Use -V to see which." << std::endl;
+    }
+
+    //For each graph, loop over problems, queueing a job for each:
+        //If "recover" flag was set, check if there's already a result with this run ID; if there is, skip it.
+        //Otherwise pick the argument for the problem, if it takes one.
+    //Then run the jobs, each on its own set of cores. For each job:
+        //Check if there's a solution. If not, and a reference solver was specified, invoke it; otherwise print a warning and skip.
+        //Now that a solution exists, run the benchmarked solver. Get results. Depending on options, save to disk.
+        //Compare results here, generate correctness, save to disk.
+
+    /******** Queue up jobs ********/
+    std::vector<BenchmarkJob> jobs;
+    std::map<std::string, std::mutex> solutionLocks; //problems resolving to the same argument share a reference solution
+    for (const UniqueGraph& graph : uniqueGraphs)
+    {   const std::string& graphFile = graph.path;
+        const std::string& currHash = graph.hash;
+        if (verbose)
+        {   std::cout << "Queueing problems for graph " << graphFile << std::endl;
+            for (const std::string& duplicate : graph.duplicates)
+            {   std::cout << "    " << duplicate << " is the same graph, so shares these results" << std::endl;
+            }
         }
 
         //create output directory if necessary
@@ -276,7 +627,6 @@ int main(int argc, char** argv)
             continue;
         }
 
-        //Now we can start looping over the problems
         for (std::string fullproblem : problems)
         {   fs::path outfp = outdir / (fullproblem + ".output");
             fs::path resfp = outdir / (fullproblem + ".stat");
@@ -285,7 +635,7 @@ int main(int argc, char** argv)
             if (recover)
             {   if (fs::exists(outfp) && fs::exists(resfp))
                 {   if (verbose)
-                    {   std::cout << "        INFO: Recovery mode is on and problem solution already exists." << std::endl;
+                    {   std::cout << "        INFO: Recovery mode is on and problem " << fullproblem << " already has a solution." << std::endl;
                     }
                     continue;
                 }
@@ -312,152 +662,341 @@ int main(int argc, char** argv)
                 }
             }
 
-            //check reference solution exists here else act accordingly
             fs::path solfp = (soldir / (problem + (additionalArg == ""? "" : ":" + additionalArg)));
-            if (!fs::exists(solfp))
-            {
-                if (referenceSolverpath == "")
-                {   if (!quiet)
-                    {   std::cout << "INFO: No reference solver specified and no solution for graph " << graphFile
-                            << " and problem " << fullproblem << "; skipping." << std::endl;
-                        continue;
-                    }
+            solutionLocks[solfp.string()];
+            jobs.push_back({graphFile, currHash, fullproblem, problem, additionalArg, outfp, resfp, solfp});
+        }
+    }
+
+    /******** Order jobs, longest first ********/
+    if (!opts["input-order"].as<bool>() && solverpath != "" && jobs.size() > 1)
+    {   RuntimeEstimator estimator(storeDir, solverexecpath.filename().string(), timeLimit > 0? timeLimit : 0);
+        size_t fromHistory = 0, fromMetrics = 0;
+        double totalSeconds = 0;
+        for (BenchmarkJob& job : jobs)
+        {   RuntimeEstimator::Estimate estimate = estimator.estimate(job.hash, job.fullproblem);
+            if (estimate.source != RuntimeEstimator::NONE)
+            {   job.predictedSeconds = estimate.seconds;
+                totalSeconds += estimate.seconds;
+                (estimate.source == RuntimeEstimator::HISTORY? fromHistory : fromMetrics)++;
+            }
+            std::error_code ec;
+            job.graphBytes = fs::file_size(job.graphFile, ec);
+        }
+        std::stable_sort(jobs.begin(), jobs.end(), [](const BenchmarkJob& a, const BenchmarkJob& b)
+            {   //a job without an estimate could be anything, so those go first, largest graphs first
+                if ((a.predictedSeconds < 0) != (b.predictedSeconds < 0))
+                {   return a.predictedSeconds < 0;
                 }
-                else if (!fs::exists(referenceSolverpath) || !(fs::is_regular_file(referenceSolverpath) || fs::is_symlink(referenceSolverpath)))
-                {   std::cerr << "WARNING: Reference solver path does not point to a file. Double-check the filepath. Skipping graphs with no existing solutions." << std::endl;
-                    continue;
+                else if (a.predictedSeconds < 0)
+                {   return a.graphBytes > b.graphBytes;
                 }
-                else
-                {   if (verbose)
-                    {   std::cout << "    No solution exists; running reference solver..." << std::endl;
-                    }
-
-                    //setup output
-                    int outfd = creat(solfp.c_str(), 0644);
-                    if (outfd < 0)
-                    {   std::cerr << "ERROR: Unable to open solution output file for writing. Skipping this problem." << std::endl;
-                        perror(NULL);
-                        continue;
-                    }
+                return a.predictedSeconds > b.predictedSeconds;
+            });
+        if (!quiet)
+        {   std::cout << "INFO: Running the longest jobs first. Expected times are known for " << fromHistory << " job(s) from previous runs and predicted for "
+                << fromMetrics << " from graph metrics, totalling " << std::fixed << std::setprecision(1) << totalSeconds << std::defaultfloat
+                << "s of CPU time; the other " << jobs.size() - fromHistory - fromMetrics << " go first." << std::endl;
+        }
+    }
 
-                    int pid = fork();
-                    if (pid < 0) //error
-                    {   std::cerr << "ERROR: Failed forking to invoke reference solver on graph " << graphFile
-                            << " and problem " << fullproblem << "; skipping." << std::endl;
-                        continue;
-                    }
-                    else if (pid > 0) //parent
-                    {   int status;
-                        wait(&status);
-                        if (!WIFEXITED(status) || (WIFEXITED(status) && WEXITSTATUS(status) == magic_number))
-                        {   std::cerr << "ERROR: Unable to execute reference solver! Skipping graph." << std::endl;
-                            if(!fs::remove(solfp))
-                            {   std::cerr << "Could not remove solution file..." << std::endl;
-                            }
-                            continue;
-                        }
-                        else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
-                        {   std::cerr << "WARNING: Reference solver exited with non-zero status: " << WEXITSTATUS(status) << std::endl;
-                        }
-                    }
-                    else //child
-                    {   if (dup2(outfd, STDOUT_FILENO) < 0)
-                        {   std::cerr << "ERROR: Unable to redirect reference solver to solution file. Skipping this." << std::endl;
-                            _exit(1);
-                        }
-                        std::vector<std::string> argvct { referenceSolverpath,
-                                "-f", graphFile,
-                                "-fo", "tgf",
-                                "-p", problem
-                            };
-                        if (additionalArg != "")
-                        {   argvct.insert(argvct.end(), { "-a", additionalArg});
-                        }
-
-                        const char** args = new const char* [argvct.size()];
-                        for (size_t i = 0; i < argvct.size(); i++)
-                        {   args[i] = argvct[i].c_str();
-                        }
-                        args[argvct.size()] = NULL;
-
-                        execv(referenceSolverpath.c_str(), (char**)args);
-                        return magic_number;
-                    }
-                }
+    /******** Set up the cores the jobs run on ********/
+    unsigned jobCount = opts["jobs"].as<unsigned>();
+    unsigned coresPerJob = opts["cores-per-job"].as<unsigned>();
+    bool numa = opts["numa"].as<bool>();
+    std::vector<CoreSlot> slots;
+    if (jobCount != 1 || numa || !opts["cores-per-job"].defaulted())
+    {   try
+        {   slots = allocateCoreSlots(jobCount, coresPerJob, numa);
+            if (slots.empty())
+            {   std::cerr << "ERROR: Not enough CPUs available to give a job " << coresPerJob << " of them. Terminating." << std::endl;
+                return 1;
             }
-
-            //Now we can invoke runsolver! Provided we have a solver argument, fork, build the command line, and execve.
-            if (solverpath == "")
-            {   continue;
+            if (jobCount > slots.size())
+            {   std::cerr << "WARNING: Only enough CPUs available for " << slots.size() << " job(s) of " << coresPerJob
+                    << " CPU(s) at once; running that many rather than " << jobCount << ", so that no two jobs share a CPU." << std::endl;
             }
-
             if (verbose)
-            {   std::cout << "        Solving problem " << problem << "..." << std::endl;
+            {   for (size_t i = 0; i < slots.size(); i++)
+                {   std::cout << "INFO: Job slot " << i + 1 << " runs on " << slots[i].describe() << std::endl;
+                }
             }
+        }
+        catch (std::system_error& e)
+        {   std::cerr << "WARNING: " << e.what() << ". Running one job at a time, without pinning it to any CPU." << std::endl;
+            slots = { CoreSlot() };
+        }
+    }
+    else
+    {   slots = { CoreSlot() }; //one job at a time, on whichever cores the system likes, as it always was
+    }
+    //Streamed outputs are read and checked while the solver runs, so when the solvers are pinned, that's done on
+    //CPUs none of them have: if every CPU is in a slot, one slot is given over to it
+    CoreSlot readerCpus;
+    if (streamOutput && !slots.front().cpus.empty())
+    {   try
+        {   readerCpus = spareCpus(slots);
+        }
+        catch (std::system_error& e)
+        {   std::cerr << "ERROR: " << e.what() << ". Terminating." << std::endl;
+            return 1;
+        }
+        if (readerCpus.cpus.empty() && slots.size() > 1)
+        {   readerCpus.cpus = slots.back().cpus;
+            slots.pop_back();
+            std::cerr << "WARNING: No CPU is left outside the job slots to read and check streamed outputs on; giving them " << readerCpus.describe()
+                << " and running " << slots.size() << " job(s) at a time." << std::endl;
+        }
+        else if (readerCpus.cpus.empty())
+        {   std::cerr << "ERROR: --stream-output needs a CPU outside the job slot to read and check outputs on, so as not to take CPU time from the solver."
+                << " Give each job fewer --cores-per-job, or don't stream outputs. Terminating." << std::endl;
+            return 1;
+        }
+        else if (verbose)
+        {   std::cout << "INFO: Streamed outputs are read and checked on " << readerCpus.describe() << std::endl;
+        }
+    }
+    if (!quiet)
+    {   std::cout << "INFO: Running " << jobs.size() << " job(s), " << std::min(slots.size(), jobs.size()) << " at a time." << std::endl;
+    }
 
-            int pid = fork();
-            if (pid < 0) //error
-            {   std::cerr << "ERROR: Failed fork for invoking solver. Skipping graph " << graphFile << " and problem " << fullproblem << "." << std::endl;
-                continue;
+    /******** Run jobs ********/
+    auto runJob = [&](const BenchmarkJob& job, size_t index)
+    {   const std::string& graphFile = job.graphFile;
+        const std::string& fullproblem = job.fullproblem;
+        const std::string& problem = job.problem;
+        const std::string& additionalArg = job.additionalArg;
+        const fs::path& outfp = job.outfp;
+        const fs::path& resfp = job.resfp;
+        const fs::path& solfp = job.solfp;
+        bool verifiable = verifyOutput && SemanticVerifier::supports(problem);
+        if (!quiet)
+        {   Report report(std::cout);
+            report << "[" << index + 1 << "/" << jobs.size() << "] Starting problem " << fullproblem << " on graph " << graphFile;
+            if (verbose && job.predictedSeconds >= 0)
+            {   report << " (expected to take " << job.predictedSeconds << "s)";
             }
-            else if (pid > 0) //parent
-            {   int status;
-                wait(&status);
-                if (!WIFEXITED(status) || (WIFEXITED(status) && WEXITSTATUS(status) == magic_number))
-                {   std::cerr << "FATAL ERROR: Failed to execute runsolver. Aborting!" << std::endl;
-                    continue;
+            report << std::endl;
+        }
+
+        //check reference solution exists here else act accordingly; jobs sharing it wait for whichever generates it
+        {   std::lock_guard<std::mutex> solutionGuard(solutionLocks.at(solfp.string()));
+            if (!fs::exists(solfp) && nativeGrounded && isGroundedProblem(problem))
+            {   if (verbose)
+                {   Report(std::cout) << "    No solution exists for " << fullproblem << " on " << graphFile << "; working out the grounded extension..." << std::endl;
                 }
-                else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
-                {   std::cerr << "WARNING: Runsolver exited with non-zero status. Skipping further processing." << std::endl;
-                    continue;
+                std::unique_ptr<Graph> graph(loadGraph(graphFile, job.hash));
+                fs::path tmp = solfp;
+                tmp += ".tmp";
+                bool written = false;
+                if (graph)
+                {   std::ofstream out(tmp);
+                    written = writeGroundedSolution(GroundedLabelling(*graph), *graph, problem, additionalArg, out) && out.flush();
+                }
+                std::error_code ec;
+                if (written)
+                {   fs::rename(tmp, solfp, ec);
+                }
+                if (!written || ec)
+                {   Report(std::cerr) << "ERROR: Unable to write the grounded solution " << solfp << " for graph " << graphFile
+                        << " and problem " << fullproblem << "; skipping." << std::endl;
+                    fs::remove(tmp, ec);
+                    return;
+                }
+            }
+            else if (!fs::exists(solfp) && referenceSolverpath == "" && verifiable)
+            {   if (verbose)
+                {   Report(std::cout) << "    No solution exists for " << fullproblem << " on " << graphFile << "; the output will only be verified against the graph" << std::endl;
                 }
             }
-            else //child
-            {   const char* runsolver = BIN_PATH "/runsolver";
-                std::vector<std::string> argvct { runsolver,
-                    "-w", "/dev/null",
-                    "-v", resfp.string(),
-                    "-o", outfp.string()
-                };
+            else if (!fs::exists(solfp))
+            {
+                if (referenceSolverpath == "")
+                {   if (!quiet)
+                    {   Report(std::cout) << "INFO: No reference solver specified and no solution for graph " << graphFile
+                            << " and problem " << fullproblem << "; skipping." << std::endl;
+                    }
+                    return;
+                }
+                else if (!fs::exists(referenceSolverpath) || !(fs::is_regular_file(referenceSolverpath) || fs::is_symlink(referenceSolverpath)))
+                {   Report(std::cerr) << "WARNING: Reference solver path does not point to a file. Double-check the filepath. Skipping graphs with no existing solutions." << std::endl;
+                    return;
+                }
 
-                if (timeLimit > 0)
-                {   argvct.push_back("-C");
-                    argvct.push_back(std::to_string(timeLimit));
+                if (verbose)
+                {   Report(std::cout) << "    No solution exists for " << fullproblem << " on " << graphFile << "; running reference solver..." << std::endl;
                 }
-                if (memLimit > 0)
-                {
-                    argvct.push_back("-M");
-                    argvct.push_back(std::to_string(memLimit));
+
+                //setup output
+                int outfd = open(solfp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+                if (outfd < 0)
+                {   Report(std::cerr) << "ERROR: Unable to open solution output file " << solfp << " for writing: "
+                        << std::generic_category().message(errno) << ". Skipping this problem." << std::endl;
+                    return;
                 }
 
-                argvct.insert(argvct.end(), { solverpath,
+                std::vector<std::string> argvct { referenceSolverpath,
                         "-f", graphFile,
                         "-fo", "tgf",
                         "-p", problem
-                        });
+                    };
                 if (additionalArg != "")
                 {   argvct.insert(argvct.end(), { "-a", additionalArg});
                 }
 
-                const char** args = new const char* [argvct.size()];
-                for (size_t i = 0; i < argvct.size(); i++)
-                {   args[i] = argvct[i].c_str();
+                int status;
+                try
+                {   status = runProgram(argvct, outfd);
+                }
+                catch (std::system_error& e)
+                {   close(outfd);
+                    Report(std::cerr) << "ERROR: " << e.what() << ". Skipping problem " << fullproblem << " on graph " << graphFile << "." << std::endl;
+                    fs::remove(solfp);
+                    return;
+                }
+                close(outfd);
+                if (status == -1)
+                {   Report(std::cerr) << "ERROR: Failed waiting for reference solver on graph " << graphFile
+                        << " and problem " << fullproblem << "; skipping." << std::endl;
+                    fs::remove(solfp);
+                    return;
                 }
-                args[argvct.size()] = NULL;
+                else if (!WIFEXITED(status))
+                {   Report(std::cerr) << "ERROR: Reference solver was killed by signal " << WTERMSIG(status) << "! Skipping problem " << fullproblem << " on graph " << graphFile << "." << std::endl;
+                    if(!fs::remove(solfp))
+                    {   Report(std::cerr) << "Could not remove solution file..." << std::endl;
+                    }
+                    return;
+                }
+                else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+                {   Report(std::cerr) << "WARNING: Reference solver exited with non-zero status: " << WEXITSTATUS(status) << std::endl;
+                }
+            }
+
+            if (solutionFormat != "text" && fs::exists(solfp) && !storeSolution(solfp, problem, solutionFormat == "binary"))
+            {   Report(std::cerr) << "WARNING: Unable to store solution " << solfp << " as " << solutionFormat << "; leaving it as it is" << std::endl;
+            }
+        }
+
+        //Now we can invoke runsolver! Provided we have a solver argument, build the command line and run it.
+        if (solverpath == "")
+        {   return;
+        }
+
+        if (verbose)
+        {   Report(std::cout) << "        Solving problem " << problem << " on " << graphFile << "..." << std::endl;
+        }
+
+        //with --stream-output, the output is checked as it arrives rather than written out and read back, unless
+        //the reference is too large to hold in memory; it's then only written out if it might be kept
+        bool haveReference = fs::exists(solfp);
+        bool streamed = streamOutput && !(haveReference && compareMemory > 0 && textSize(solfp) > compareMemory);
+        if (streamOutput && !streamed && verbose)
+        {   Report(std::cout) << "        Reference solution too large to hold in memory; writing the output to " << outfp << std::endl;
+        }
+        std::unique_ptr<OutputSink> sink;
+        std::unique_ptr<StreamedComparison> comparison;
+        std::unique_ptr<Graph> graph;
+        std::unique_ptr<SemanticVerifier> verifier;
+        std::unique_ptr<SemanticVerifier::Check> check;
+        std::string verifyError;
+        if (streamed)
+        {   //the largest output that could be kept, correct or not
+            std::uintmax_t unlimited = std::numeric_limits<std::uintmax_t>::max();
+            std::uintmax_t keepCorrect = (!saveAll? 0 : saveCorrectMaxSize > 0? saveCorrectMaxSize : unlimited);
+            sink = std::make_unique<OutputSink>(outfp, std::max(keepCorrect, saveMaxSize > 0? saveMaxSize : unlimited), compressOutputs);
+            if (haveReference)
+            {   comparison = std::make_unique<StreamedComparison>(solfp, outfp);
+            }
+            if (verifiable)
+            {   try
+                {   graph.reset(loadGraph(graphFile, job.hash));
+                    if (!graph)
+                    {   throw std::runtime_error("unable to load graph " + graphFile);
+                    }
+                    verifier = std::make_unique<SemanticVerifier>(*graph);
+                    check = std::make_unique<SemanticVerifier::Check>(*verifier, problem, additionalArg, outfp);
+                }
+                catch (std::runtime_error& e)
+                {   verifyError = e.what();
+                }
+            }
+        }
+
+        //runsolver sends the solver's standard error along with its output, to the pipe as well when streamed
+        std::vector<std::string> argvct { BIN_PATH "/runsolver",
+            "-w", "/dev/null",
+            "-v", resfp.string(),
+            "-o", (streamed? "/dev/stdout" : outfp.string())
+        };
 
-                execv(runsolver, (char**)args);
-                return magic_number;
+        if (timeLimit > 0)
+        {   argvct.push_back("-C");
+            argvct.push_back(std::to_string(timeLimit));
+        }
+        if (memLimit > 0)
+        {
+            argvct.push_back("-M");
+            argvct.push_back(std::to_string(memLimit));
+        }
+
+        argvct.insert(argvct.end(), { solverpath,
+                "-f", graphFile,
+                "-fo", "tgf",
+                "-p", problem
+                });
+        if (additionalArg != "")
+        {   argvct.insert(argvct.end(), { "-a", additionalArg});
+        }
+
+        auto onOutput = [&](std::string_view chunk)
+        {   sink->write(chunk);
+            if (comparison)
+            {   comparison->feed(chunk);
+            }
+            if (check && verifyError.empty())
+            {   try
+                {   check->feed(chunk);
+                }
+                catch (std::runtime_error& e)
+                {   verifyError = e.what();
+                }
             }
+        };
+        int status;
+        try
+        {   status = (streamed? runProgram(argvct, onOutput, readerCpus) : runProgram(argvct));
+        }
+        catch (std::system_error& e)
+        {   Report(std::cerr) << "ERROR: " << e.what() << ". Skipping graph " << graphFile << " and problem " << fullproblem << "." << std::endl;
+            return;
+        }
+        if (status == -1)
+        {   Report(std::cerr) << "ERROR: Failed waiting for runsolver. Skipping graph " << graphFile << " and problem " << fullproblem << "." << std::endl;
+            return;
+        }
+        else if (!WIFEXITED(status))
+        {   Report(std::cerr) << "ERROR: Runsolver was killed by signal " << WTERMSIG(status) << ". Skipping graph " << graphFile << " and problem " << fullproblem << "." << std::endl;
+            return;
+        }
+        else if (WIFEXITED(status) && WEXITSTATUS(status) != 0)
+        {   Report(std::cerr) << "WARNING: Runsolver exited with non-zero status. Skipping further processing." << std::endl;
+            if (sink && !sink->keep())
+            {   sink->discard();
+            }
+            return;
+        }
 
-            //runsolver is done
-            //now compare solutions
-            bool is_correct;
-            long total, correct, wrong;
-            total = correct = wrong = 0;
+        //runsolver is done
+        //now compare solutions, if there's a reference one
+        bool is_correct = false;
+        long total, correct, wrong;
+        total = correct = wrong = 0;
 
-            //First we check for decision problem output ("YES" or "NO") and compare manually
-            std::ifstream outif(outfp.c_str());
-            std::string firstWordBuff;
+        //First we check for decision problem output ("YES" or "NO") and compare manually
+        std::string firstWordBuff;
+        if (haveReference && !streamed)
+        {   std::ifstream outif(outfp.c_str());
             char b;
             while (outif >> b) //here we extract just the first word
             {   if (!std::isalpha(b))
@@ -465,81 +1004,174 @@ int main(int argc, char** argv)
                 }
                 firstWordBuff += b;
             }
-            if (firstWordBuff == "YES" || firstWordBuff == "NO")
-            {   std::ifstream solif(solfp.c_str());
-                std::string solWordBuff;
-                std::getline(solif, solWordBuff);
-                is_correct = (solWordBuff == firstWordBuff);
-            }
-            else //We need to compare extensions
-            {   if (verbose) std::cout << "        Running compare-extensions..." << std::endl;
-                std::string binPath = BIN_PATH "/compare-extensions";
-                std::vector<std::string> argv {binPath, solfp, outfp};
-                redi::ipstream in(binPath, argv);
-
-                std::string status;
-                std::getline(in, status);
-                if (status != "OK" && status != "WRONG")
-                {   std::cerr << "ERROR: Unable to verify solution " << outfp << " against master " << solfp
-                    << ". No correctness report will be generated. Error message: " << status << std::endl;
-                    in.close();
-                    is_correct = false; //provide default
+        }
+        if (!haveReference)
+        { } //only verified, below
+        else if (streamed)
+        {   try
+            {   ExtensionComparison result = comparison->finish();
+                is_correct = result.ok;
+                total = result.total;
+                correct = result.correct;
+                wrong = result.wrong;
+            }
+            catch (std::runtime_error& e)
+            {   Report(std::cerr) << "ERROR: Unable to verify solution " << outfp << " against master " << solfp
+                << ". No correctness report will be generated. Error message: " << e.what() << std::endl;
+                is_correct = false; //provide default
+            }
+        }
+        else if (firstWordBuff == "YES" || firstWordBuff == "NO")
+        {   is_correct = (readFirstLine(solfp) == firstWordBuff);
+        }
+        else //We need to compare extensions
+        {   if (verbose) Report(std::cout) << "        Comparing extensions in " << outfp << "..." << std::endl;
+            try
+            {   //matching fingerprints mean the same extensions, so only a mismatch needs the solutions parsed
+                ExtensionFingerprint expected = ExtensionFingerprint::loadReference(solfp);
+                if (expected == ExtensionFingerprint::of(outfp))
+                {   is_correct = true;
+                    total = correct = expected.count;
+                }
+                else if (compareMemory > 0 && textSize(solfp) + fs::file_size(outfp) > compareMemory)
+                {   if (verbose) Report(std::cout) << "        Solutions too large to compare in memory; using temporary files" << std::endl;
+                    ExtensionComparison comparison = compareExtensionFiles(solfp, outfp, compareMemory, fs::path(outfp).parent_path());
+                    is_correct = comparison.ok;
+                    total = comparison.total;
+                    correct = comparison.correct;
+                    wrong = comparison.wrong;
                 }
                 else
-                {   is_correct = (status == "OK"? true : false);
-                    std::string totalstr, correctstr, wrongstr;
-                    std::getline(in, totalstr, ' '); std::getline(in, status);
-                    std::getline(in, correctstr, ' '); std::getline(in, status);
-                    std::getline(in, wrongstr, ' '); std::getline(in, status);
-                    try
-                    {   total = std::stol(totalstr);
-                        correct = std::stol(correctstr);
-                        wrong = std::stol(wrongstr);
-                    }
-                    catch (std::exception& e)
-                    {   std::cerr << "ERROR: solution comparison did not return correct values for the number of correct, wrong, and total extensions." << std::endl;
-                        total = correct = wrong = -1;
-                    }
-                    in.close();
-
-                    int err, status = 0;
-                    if ((err = in.rdbuf()->error()) == 0 && in.rdbuf()->exited()) {
-                        status = in.rdbuf()->status();
-                    } else {
-                        std::cerr << "        WARNING: Error executing solution comparison: " << err << std::endl;
-                    }
-                    if (status != 0 && verbose) {
-                        std::cerr << "        INFO: Solution comparison exit status: " << status << std::endl;
-                    }
+                {   ExtensionSet reference = ExtensionSet::loadReference(solfp);
+                    ExtensionComparison comparison = compareExtensions(reference, ExtensionSet::parse(outfp, &reference));
+                    is_correct = comparison.ok;
+                    total = comparison.total;
+                    correct = comparison.correct;
+                    wrong = comparison.wrong;
                 }
             }
-
-            if (verbose)
-            {   std::cout << "        INFO: Correct: " << is_correct << "; total: " << total << "; correct: " << correct << "; wrong: " << wrong << "." << std::endl;
+            catch (std::runtime_error& e)
+            {   Report(std::cerr) << "ERROR: Unable to verify solution " << outfp << " against master " << solfp
+                << ". No correctness report will be generated. Error message: " << e.what() << std::endl;
+                is_correct = false; //provide default
             }
+        }
 
-            //save to .stat here
-            std::ofstream statof(resfp, std::ios::app);
-            statof << "ISCORRECT=" << (is_correct? "true" : "false" ) << "\n"
+        if (verbose && haveReference)
+        {   Report(std::cout) << "        INFO: " << fullproblem << " on " << graphFile << ": Correct: " << is_correct
+                << "; total: " << total << "; correct: " << correct << "; wrong: " << wrong << "." << std::endl;
+        }
+
+        //save to .stat here
+        std::ofstream statof(resfp, std::ios::app);
+        if (haveReference)
+        {   statof << "ISCORRECT=" << (is_correct? "true" : "false" ) << "\n"
                 << "TOTALEXTS=" << total << "\n"
                 << "CORRECTEXTS=" << correct << "\n"
                 << "WRONGEXTS=" << wrong << std::endl;
+        }
 
-            //now cleanup results if they're too large
-            if (is_correct)
-            {   if(!saveAll || (saveCorrectMaxSize > 0 && fs::file_size(outfp) > saveCorrectMaxSize))
-                {   if (verbose) std::cout << "    Removing (correct) solution as " << (saveAll? "it's above max size" : "--save-all was not passed") << std::endl;
-                    fs::remove(outfp);
+        //check the extensions output against the graph itself; without a reference, this is all there is to go on
+        if (verifiable)
+        {   try
+            {   SemanticVerifier::Result verification;
+                if (streamed)
+                {   if (!verifyError.empty())
+                    {   throw std::runtime_error(verifyError);
+                    }
+                    verification = check->finish();
+                }
+                else
+                {   graph.reset(loadGraph(graphFile, job.hash));
+                    if (!graph)
+                    {   throw std::runtime_error("unable to load graph " + graphFile);
+                    }
+                    verification = SemanticVerifier(*graph).verify(outfp, problem, additionalArg);
+                }
+                statof << "VALIDEXTS=" << verification.valid << "\n"
+                    << "INVALIDEXTS=" << verification.invalid << "\n";
+                if (!verification.invalidIndices.empty())
+                {   statof << "INVALIDEXTINDICES=";
+                    for (size_t i = 0; i < verification.invalidIndices.size(); i++)
+                    {   statof << (i == 0? "" : ",") << verification.invalidIndices[i];
+                    }
+                    statof << "\n";
+                }
+                statof.flush();
+                if (!haveReference)
+                {   is_correct = (verification.invalid == 0);
+                }
+                if (verbose)
+                {   Report(std::cout) << "        INFO: " << fullproblem << " on " << graphFile << ": valid extensions: " << verification.valid
+                        << "; invalid: " << verification.invalid << "." << std::endl;
                 }
             }
-            else if (!is_correct && saveMaxSize > 0 && fs::file_size(outfp) > saveMaxSize)
-            {   if (verbose) std::cout << "    Removing (incorrect) solution as it's above max size" << std::endl;
-                fs::remove(outfp);
+            catch (std::runtime_error& e)
+            {   Report(std::cerr) << "ERROR: Unable to verify the extensions in " << outfp << ": " << e.what() << std::endl;
             }
         }
-        std::cout << "    Done" << std::endl;
+
+        //now cleanup results if they're too large; a streamed output is only written out if it's kept
+        std::uintmax_t outputSize = (streamed? sink->size() : fs::file_size(outfp));
+        bool keepOutput = true;
+        if (is_correct)
+        {   if(!saveAll || (saveCorrectMaxSize > 0 && outputSize > saveCorrectMaxSize))
+            {   if (verbose) Report(std::cout) << "    Removing (correct) solution " << outfp << " as " << (saveAll? "it's above max size" : "--save-all was not passed") << std::endl;
+                keepOutput = false;
+            }
+        }
+        else if (!is_correct && saveMaxSize > 0 && outputSize > saveMaxSize)
+        {   if (verbose) Report(std::cout) << "    Removing (incorrect) solution " << outfp << " as it's above max size" << std::endl;
+            keepOutput = false;
+        }
+        if (!streamed && !keepOutput)
+        {   fs::remove(outfp);
+        }
+        else if (!streamed && compressOutputs && !compressFile(outfp))
+        {   Report(std::cerr) << "WARNING: Unable to compress solution " << outfp << "; keeping it as it is" << std::endl;
+        }
+        else if (streamed && !keepOutput)
+        {   sink->discard();
+        }
+        else if (streamed && !sink->keep())
+        {   Report(std::cerr) << "ERROR: " << sink->error() << std::endl;
+            sink->discard();
+        }
+    };
+
+    //each slot gets a thread of its own, pinned to it, which takes the next job whenever it's done with one;
+    //every process a job starts inherits the pinning
+    std::atomic<size_t> nextJob(0);
+    auto work = [&](const CoreSlot& slot)
+    {   if (!slot.cpus.empty())
+        {   try
+            {   bindToSlot(slot);
+            }
+            catch (std::system_error& e)
+            {   Report(std::cerr) << "ERROR: " << e.what() << ". No jobs will run there." << std::endl;
+                return;
+            }
+        }
+        for (size_t i; (i = nextJob++) < jobs.size(); )
+        {   try
+            {   runJob(jobs[i], i);
+            }
+            catch (std::exception& e)
+            {   Report(std::cerr) << "ERROR: Problem " << jobs[i].fullproblem << " on graph " << jobs[i].graphFile << " failed: " << e.what() << std::endl;
+            }
+        }
+    };
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < slots.size() && i < jobs.size(); i++)
+    {   workers.emplace_back(work, std::cref(slots[i]));
+    }
+    for (std::thread& worker : workers)
+    {   worker.join();
     }
+    if (!quiet)
+    {   std::cout << "Done" << std::endl;
+    }
+
     argCache.save();
     ghset.save();
 }
-
@@ -0,0 +1,57 @@
+#ifndef COMPRESSEDFILE_H
+#define COMPRESSEDFILE_H
+
+#include <string>
+#include <cstdint>
+#include <string_view>
+#include <functional>
+#include <filesystem>
+#include <zlib.h>
+
+namespace fs = std::filesystem;
+
+//Reference solutions and solver outputs may be stored gzip-compressed, under their usual names: readers tell
+//the two apart by the gzip magic number, so compressing a file is transparent to them (and zcat reads it).
+
+//True if the file starts with the gzip magic number; false if it doesn't, or can't be read
+bool isCompressed(const fs::path& file);
+//Hands the text of the file to onChunk, decompressing it as it goes if it's compressed: a plain file in one
+//chunk, mapped into memory, a compressed one a piece at a time. Throws std::runtime_error if the file can't be
+//read or decompressed.
+void readChunks(const fs::path& file, const std::function<void(std::string_view)>& onChunk);
+//The size of the file's text: for a compressed file, as its gzip trailer records it, which only holds it modulo
+//4 GiB (so it's taken to be at least the compressed size). Throws std::filesystem::filesystem_error as
+//fs::file_size() does.
+std::uintmax_t textSize(const fs::path& file);
+//True if the file's text (decompressed if need be) starts with prefix
+bool startsWith(const fs::path& file, std::string_view prefix);
+//The first line of the file, without its newline, e.g. a decision problem's answer; empty if it can't be read
+std::string readFirstLine(const fs::path& file);
+//Compresses the file in place, atomically (via a temporary file and a rename); false if it couldn't be. Files
+//that already are compressed are left alone.
+bool compressFile(const fs::path& file);
+
+//Writes a gzip-compressed file a chunk at a time. The file is only complete once close() has succeeded.
+class CompressedWriter
+{
+    public:
+        static const int defaultLevel = 6;
+
+        //Throws std::runtime_error if the file can't be created
+        CompressedWriter(const fs::path& file, int level = defaultLevel);
+        ~CompressedWriter();
+        CompressedWriter(const CompressedWriter&) = delete;
+        CompressedWriter& operator=(const CompressedWriter&) = delete;
+        //Both false on failure, after which nothing more is written
+        bool write(std::string_view data);
+        bool close();
+        const std::string& error() const; //why it failed, starting with the file's name; empty if it hasn't
+    private:
+        void fail(const std::string& message);
+        fs::path file;
+        gzFile out;
+        bool failed = false;
+        std::string failure;
+};
+
+#endif
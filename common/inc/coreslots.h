@@ -0,0 +1,45 @@
+#ifndef CORESLOTS_H
+#define CORESLOTS_H
+
+#include <string>
+#include <vector>
+#include <sched.h>
+
+//A set of CPUs dedicated to one of several jobs running side by side, so that the jobs never compete for
+//a core and their timings stay comparable to running them one at a time.
+struct CoreSlot
+{
+    std::vector<int> cpus;
+    int node = -1; //NUMA node the slot's memory is bound to; -1 for none
+    std::string describe() const;
+};
+
+//Splits the CPUs this process may run on into (at most) `slots` disjoint slots of `coresPerSlot` CPUs each;
+//0 slots means as many as fit. Physical cores are handed out before their hyperthread siblings, so slots
+//only share a physical core once every core is in use. With `numa`, each slot lies within a single NUMA
+//node, and slots alternate between nodes. Fewer slots than asked for are returned if the CPUs run out.
+std::vector<CoreSlot> allocateCoreSlots(unsigned slots, unsigned coresPerSlot, bool numa);
+
+//Restricts the calling thread, and every process it starts from now on, to the slot's CPUs and, if the
+//slot has a node, to that node's memory. Throws std::system_error if the kernel refuses.
+void bindToSlot(const CoreSlot& slot);
+
+//The CPUs this process may run on that none of the slots has, as a slot of their own (with no node); it has
+//no CPUs if there are none to spare.
+CoreSlot spareCpus(const std::vector<CoreSlot>& slots);
+
+//While it exists, the calling thread runs on the slot's CPUs rather than the ones it was on, e.g. to do work
+//that mustn't compete with the processes it started from a slot, which keep their pinning. Its memory stays
+//where it was bound. Throws std::system_error if the kernel refuses.
+class TemporaryPinning
+{
+    public:
+        TemporaryPinning(const CoreSlot& slot);
+        ~TemporaryPinning();
+        TemporaryPinning(const TemporaryPinning&) = delete;
+        TemporaryPinning& operator=(const TemporaryPinning&) = delete;
+    private:
+        cpu_set_t previous;
+};
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef EXTENSIONSET_H
+#define EXTENSIONSET_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <unordered_map>
+#include <functional>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+struct FileStamp;
+
+//The result of checking a solver's extensions against the reference solution
+struct ExtensionComparison
+{
+    bool ok; //exactly the same extensions, each as many times
+    long total; //extensions in the reference
+    long correct; //extensions of the solver's that are also in the reference
+    long wrong; //the rest of the solver's
+};
+
+//A solution to an enumeration problem in the ICCMA format ("[[a1,a2],[a3]]", or "[a1,a2]" for a single
+//extension) - read exactly as compare-extensions always did - in canonical form, so that two sets are compared
+//in a single merge. All the extensions live in one arena of 32-bit words, in sorted order, each either as the
+//sorted ids of its arguments or, if that takes less space overall (i.e. extensions hold more than about one
+//in 32 arguments), as a fixed-width bitset of them; comparing two extensions is then a memcmp.
+//Solution files may be gzip-compressed (see compressedfile.h), or encoded: stored as the arena itself, names
+//and all, in place of the text, and then compressed or not.
+class ExtensionSet
+{
+    public:
+        //Throws std::runtime_error if the file can't be read or isn't a list of extensions. If a reference is
+        //given, the extensions are encoded as there, so that the two can be compared; extensions naming
+        //arguments the reference never mentions can't be correct, so are only counted.
+        static ExtensionSet parse(const fs::path& file, const ExtensionSet* reference = nullptr);
+        //As parse(), but kept parsed beside the solution file (as <file>.exts) for as long as the file is
+        //unchanged, so each reference solution is only parsed once whatever the solver and run ID (compressed, if
+        //the solution is). An encoded file is simply loaded.
+        static ExtensionSet loadReference(const fs::path& file);
+        //Replaces a solution file by its encoding (uncompressed), atomically; throws std::runtime_error as
+        //parse() does, or if it can't be written. Only for solutions that are lists of extensions (e.g. not a
+        //decision's answer).
+        static void encode(const fs::path& file);
+        static bool isEncoded(const fs::path& file);
+        size_t size() const;
+        //Hands over the text of each extension, from its '[' (without the ']'), in the set's order; only for
+        //sets that keep their names, i.e. references
+        void forEachText(const std::function<void(std::string_view)>& onExtension) const;
+    private:
+        friend ExtensionComparison compareExtensions(const ExtensionSet& reference, const ExtensionSet& candidate);
+        friend class ExtensionStream;
+        struct Extension
+        {
+            const uint32_t* words;
+            size_t count;
+            bool operator==(const Extension& other) const;
+            bool operator<(const Extension& other) const; //shorter first, then memcmp order
+        };
+        size_t stored() const;
+        Extension extension(size_t i) const;
+        void encodeDense(size_t width);
+        void sortExtensions();
+        //source is the solution file a cache was made from, or null for an encoded solution
+        bool readArena(const fs::path& arenaFile, const fs::path* source);
+        void writeArena(std::ostream& out, const char* magic, const FileStamp& source) const;
+        void writeCache(const fs::path& cacheFile, const fs::path& file) const;
+
+        std::vector<std::string> names; //by id; only kept for references
+        std::unordered_map<std::string, uint32_t> ids;
+        bool dense = false;
+        size_t width = 0; //words per extension, when dense
+        std::vector<uint32_t> words; //the arena
+        std::vector<uint64_t> offsets; //when not dense, where each extension starts in the arena, then where the last ends
+        size_t foreign = 0; //extensions naming arguments the reference doesn't, which aren't stored
+};
+
+ExtensionComparison compareExtensions(const ExtensionSet& reference, const ExtensionSet& candidate);
+//The same comparison, for solutions too large to hold in memory: each is read into sorted runs of at most about
+//memoryLimit bytes of extensions, spilled to temporary files (in a directory of their own under tmpDir, removed
+//afterwards) and merged from there. Only the names of the reference's arguments are kept in memory throughout.
+//Throws std::runtime_error as ExtensionSet::parse() does, or if the temporary files can't be written.
+ExtensionComparison compareExtensionFiles(const fs::path& referenceFile, const fs::path& candidateFile, size_t memoryLimit, const fs::path& tmpDir);
+
+//Splits a solution that arrives in chunks into its extensions, exactly as ExtensionSet::parse() reads a whole
+//file however the text is split, handing the text of each to onExtension as soon as its ']' arrives. Text is only
+//buffered while an extension spans chunks.
+class ExtensionSplitter
+{
+    public:
+        //source only names the solution in error messages
+        ExtensionSplitter(const fs::path& source, std::function<void(std::string_view)> onExtension);
+        ExtensionSplitter(const ExtensionSplitter&) = delete;
+        ExtensionSplitter& operator=(const ExtensionSplitter&) = delete;
+        //Throws std::runtime_error as ExtensionSet::parse() does
+        void feed(std::string_view chunk);
+        bool done() const { return finished; }
+    private:
+        size_t consume(std::string_view text);
+
+        fs::path source;
+        std::function<void(std::string_view)> onExtension;
+        std::string pending; //the text since the last ']', while it spans chunks
+        size_t offset = 0; //of the start of pending (or of the next chunk) in the solution
+        bool first = true;
+        bool finished = false; //past the list's closing bracket
+};
+
+//compareExtensions() for a solution that arrives in chunks (e.g. read from a solver's pipe) rather than as a
+//file: each extension is looked up in the reference as soon as its ']' arrives, so only the one being read is
+//ever held. The reference must outlive the stream.
+class ExtensionStream
+{
+    public:
+        //source only names the solution in error messages
+        ExtensionStream(const ExtensionSet& reference, const fs::path& source);
+        //Throws std::runtime_error as ExtensionSet::parse() does
+        void feed(std::string_view chunk);
+        ExtensionComparison finish() const;
+    private:
+        void match(std::string_view extension);
+
+        const ExtensionSet& reference;
+        ExtensionSplitter splitter;
+        std::string name;
+        std::vector<uint32_t> ids, bitset;
+        std::vector<uint32_t> matched; //for the first of each run of equal reference extensions, how many were found
+        long candidates = 0;
+        long correct = 0;
+};
+
+//An order-independent digest of a solution, read exactly as ExtensionSet reads it: the number of extensions,
+//and the sum (mod 2^128) of a 128-bit hash of each, made from the sorted hashes of its arguments' names.
+//Computing one takes a single pass over the file and only ever keeps one extension's worth of hashes, so
+//two solutions can be told equal (as ExtensionSets, barring a hash collision) without being parsed.
+struct ExtensionFingerprint
+{
+    uint64_t count = 0;
+    uint64_t sum[2] = { 0, 0 };
+
+    //Throws std::runtime_error as ExtensionSet::parse() does
+    static ExtensionFingerprint of(const fs::path& file);
+    //As of(), but kept beside the solution file (as <file>.fp) for as long as the file is unchanged
+    static ExtensionFingerprint loadReference(const fs::path& file);
+    bool operator==(const ExtensionFingerprint& other) const;
+    bool operator!=(const ExtensionFingerprint& other) const { return !(*this == other); }
+};
+
+#endif
@@ -5,7 +5,10 @@
 #include <utility>
 #include <map>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <mutex>
+#include <cstdint>
 
 struct Argument
 {
@@ -25,29 +28,88 @@ struct Argument
     bool operator>=(const Argument& other)      const { return !(*this < other); }
 };
 
+//A contiguous run of argument indices inside one of the CSR arrays, usable in range-for loops
+class ArgRange
+{
+    public:
+        ArgRange(const int32_t* first, const int32_t* last) : first(first), last(last) {
+        }
+        const int32_t* begin() const { return first; }
+        const int32_t* end() const { return last; }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+    private:
+        const int32_t* first;
+        const int32_t* last;
+};
+
+//The graph's storage, laid out as buildIndex() leaves it. Normally this points into the Graph's own
+//vectors, but a Graph can also be built directly over memory owned by something else (e.g. a mapped file).
+struct GraphData
+{
+    const char* names = nullptr; //all argument names back to back
+    size_t nameBytes = 0;
+    const uint64_t* nameOffsets = nullptr; //argCount + 1 entries; name i is names[nameOffsets[i], nameOffsets[i + 1])
+    int32_t argCount = 0;
+    const int32_t* outOffsets = nullptr; //argCount + 1 entries, indexing outTargets
+    const int32_t* outTargets = nullptr;
+    const int32_t* inOffsets = nullptr; //argCount + 1 entries, indexing inSources
+    const int32_t* inSources = nullptr;
+    size_t attackCount = 0;
+};
+
+//Arguments are identified by their index (0 to argCount() - 1, in insertion order). Attacks are
+//collected with addAttack and then packed into compressed sparse row form, both by source (out-edges)
+//and by target (in-edges), by buildIndex(), which must be called before the graph is queried.
+//A graph built over borrowed GraphData is read-only: adding to it throws std::logic_error.
 class Graph
 {
     public:
         Graph(std::string);
-        Graph() {};
-        void addArgument(std::shared_ptr<Argument>);
-        void addArgument(std::string, int);
+        Graph();
+        Graph(std::string, GraphData, std::shared_ptr<const void>); //the last argument keeps the data's memory alive
+        void reserve(int32_t, size_t, size_t); //arguments, total bytes of names, attacks
+        int32_t addArgument(std::string_view);
+        void addAttack(int32_t, int32_t);
+        void buildIndex();
         void printArgs() const;
         void printAttacks() const;
         void printOut() const;
         void setHash(std::string);
+        int32_t argCount() const;
+        size_t attackCount() const;
+        std::string_view argName(int32_t) const;
+        ArgRange attacksFrom(int32_t) const; //arguments attacked by the given one
+        ArgRange attackersOf(int32_t) const; //arguments attacking the given one
+        const GraphData& data() const; //only complete once the index is built
+        //compatibility views, materialised from the index on first use
         const std::vector<std::shared_ptr<Argument>>& getArgs() const;
         const std::vector<std::pair<std::shared_ptr<Argument>, std::shared_ptr<Argument>>>& getAttacks() const;
-        void addAttack(std::shared_ptr<Argument>, std::shared_ptr<Argument>);
-        //void addAttack(std::string, std::string); //currently has abysmal performance - not exposed pending rewrite, which is deferred since it's not clear this overload is actually useful
         std::string hash() const;
         std::string fname() const;
         unsigned long size() const;
     private:
+        void bindData();
+        void checkWritable() const;
+
         std::string hashval;
         std::string infname;
-        std::vector<std::shared_ptr<Argument>> args;
-        std::vector<std::pair<std::shared_ptr<Argument>, std::shared_ptr<Argument>>> attacks;
+
+        std::string nameData; //all argument names back to back
+        std::vector<uint64_t> nameOffsets { 0 }; //name i is nameData[nameOffsets[i], nameOffsets[i + 1])
+        std::vector<int32_t> pendingSources; //attacks added but not yet indexed
+        std::vector<int32_t> pendingTargets;
+        std::vector<int32_t> outOffsets { 0 };
+        std::vector<int32_t> outTargets;
+        std::vector<int32_t> inOffsets { 0 };
+        std::vector<int32_t> inSources;
+        GraphData storage; //what the accessors read: the vectors above, or borrowed memory
+        std::shared_ptr<const void> storageOwner; //set if the memory is borrowed
+
+        mutable std::once_flag argsViewFlag;
+        mutable std::once_flag attacksViewFlag;
+        mutable std::vector<std::shared_ptr<Argument>> args;
+        mutable std::vector<std::pair<std::shared_ptr<Argument>, std::shared_ptr<Argument>>> attacks;
 };
 
 #endif
@@ -0,0 +1,20 @@
+#ifndef GRAPHCACHE_H
+#define GRAPHCACHE_H
+
+#include <string>
+#include <memory>
+#include <filesystem>
+#include "graph.h"
+
+namespace fs = std::filesystem;
+
+//Binary snapshots of parsed graphs: the argument name table and both CSR indices, as laid out in
+//memory, plus the hash. Loading one just maps the file, so the graph is usable without any parsing.
+//Snapshots are stored under the graph's hash in the store's graph-cache directory.
+
+//Writes the snapshot atomically (via a temporary file and a rename); false on failure
+bool writeGraphSnapshot(const Graph& graph, const fs::path& file);
+//nullptr if there's no valid snapshot with the given hash in the file
+std::unique_ptr<Graph> readGraphSnapshot(const fs::path& file, const std::string& graphFile, const std::string& hash);
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef GRAPHHASHINDEX_H
+#define GRAPHHASHINDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+#include <memory>
+#include <filesystem>
+#include <cstdint>
+#include "mappedfile.h"
+
+namespace fs = std::filesystem;
+
+//The store's graphhashindex file: every (path, hash) pair in the hash cache, sorted both by hash and
+//by path, so that either can be looked up by binary search straight from the mapped file, without
+//loading the cache or reading any graph. It is rewritten whenever the hash cache is saved, so it
+//describes the graph files as they were when they were last hashed.
+class GraphHashIndex
+{
+    public:
+        //Throws std::system_error if the file can't be mapped, or std::runtime_error if it isn't a valid index
+        GraphHashIndex(const fs::path& file);
+        //Writes the index atomically (via a temporary file and a rename); false on failure
+        static bool write(const fs::path& file, std::vector<std::pair<std::string, std::string>> pathsAndHashes);
+
+        size_t size() const;
+        std::vector<std::string_view> pathsOf(std::string_view hash) const; //sorted
+        std::string_view hashOf(std::string_view path) const; //empty if the path isn't indexed
+        //every hash shared by more than one path, with those paths
+        std::vector<std::pair<std::string_view, std::vector<std::string_view>>> duplicates() const;
+    private:
+        struct Entry
+        {
+            uint64_t pathOffset;
+            uint64_t hashOffset;
+            uint32_t pathLength;
+            uint32_t hashLength;
+        };
+        std::string_view path(const Entry&) const;
+        std::string_view hash(const Entry&) const;
+
+        std::unique_ptr<MappedFile> map;
+        const Entry* byHash = nullptr; //sorted by hash, then path
+        const Entry* byPath = nullptr; //sorted by path
+        const char* strings = nullptr;
+        uint64_t count = 0;
+        uint64_t stringBytes = 0;
+};
+
+#endif
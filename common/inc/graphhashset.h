@@ -5,19 +5,47 @@
 #include <fstream>
 #include <string>
 #include <filesystem>
+#include <mutex>
+#include <cstdint>
 
 namespace fs = std::filesystem;
 
+//Identifies one version of a file: if the contents change, at least one of these does too
+struct FileStamp
+{
+    bool valid = false; //false if the file couldn't be examined
+    uint64_t size = 0;
+    int64_t mtimeNs = 0;
+    uint64_t inode = 0;
+    bool operator==(const FileStamp& other) const { return valid && other.valid && size == other.size && mtimeNs == other.mtimeNs && inode == other.inode; }
+    static FileStamp of(const std::string& path);
+    bool recent() const; //modified so recently that it could change again within the same mtime tick, unnoticed
+};
+
+//The store's cache of graph hashes, keyed by path. Each entry records the file's stamp when it was hashed,
+//and is only used while the file still matches it. Entries written before stamps were recorded are only
+//trusted if asked to (the old --use-hash-cache behaviour).
+//All members are safe to call concurrently
 class GraphHashSet
 {
     public:
-        GraphHashSet();
-        bool exists(std::string) const;
-        std::string getHash(std::string) const;
-        void setHash(std::string, std::string);
+        GraphHashSet(bool trustUnstamped = false);
+        //the cached hash, or empty if there is none for the file as it is now (current is its stamp, taken by the caller)
+        std::string lookup(const std::string& graphFile, const FileStamp& current) const;
+        //stamp should be taken before the file is read, so changes made while hashing it aren't missed.
+        //Files modified in the last couple of seconds aren't recorded, as they could change again unnoticed.
+        void setHash(std::string graphFile, std::string hash, FileStamp stamp);
+        void remove(const std::string& graphFile);
         void save() const;
     private:
-        std::unordered_map<std::string, std::string> hashmap;
+        struct Entry
+        {
+            std::string hash;
+            FileStamp stamp;
+        };
+        std::unordered_map<std::string, Entry> hashmap;
+        bool trustUnstamped;
+        mutable std::mutex lock;
 };
 
 #endif
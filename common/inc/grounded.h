@@ -0,0 +1,37 @@
+#ifndef GROUNDED_H
+#define GROUNDED_H
+
+#include <vector>
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include "graph.h"
+
+//The grounded labelling of a graph, computed in linear time: every argument starts with a counter of
+//its attackers not yet labelled OUT; arguments whose counter reaches zero are labelled IN, which
+//labels everything they attack OUT, which in turn decrements the counters of the arguments attacked by those.
+//Whatever is left over is UNDEC.
+class GroundedLabelling
+{
+    public:
+        enum Label : uint8_t { UNDEC, IN, OUT };
+        GroundedLabelling(const Graph&);
+        Label label(int32_t arg) const;
+        const std::vector<Label>& labels() const;
+        int32_t inCount() const;
+        int32_t outCount() const;
+        int32_t undecCount() const;
+    private:
+        std::vector<Label> argLabels;
+        int32_t ins = 0;
+        int32_t outs = 0;
+};
+
+//True for the grounded-semantics problems (DC-GR, DS-GR, SE-GR, EE-GR, CE-GR), whose solutions only take
+//the grounded labelling, there being exactly one grounded extension
+bool isGroundedProblem(const std::string& problem);
+//Writes the solution to such a problem in the ICCMA format, as a reference solver would. For DC and DS, the
+//argument is given by name; false if it isn't in the graph, or the problem isn't a grounded one.
+bool writeGroundedSolution(const GroundedLabelling& grounded, const Graph& graph, const std::string& problem, const std::string& argument, std::ostream& out);
+
+#endif
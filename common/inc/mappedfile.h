@@ -0,0 +1,25 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+//Read-only, private memory mapping of a whole file. Throws std::system_error if the file can't be mapped.
+//By default the kernel is told it will be read front to back; otherwise just to start reading it all in.
+class MappedFile
+{
+    public:
+        MappedFile(const std::string& path, bool sequential = true);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        const char* data() const;
+        size_t size() const;
+        std::string_view view() const;
+    private:
+        const char* addr = nullptr;
+        size_t length = 0;
+};
+
+#endif
@@ -8,6 +8,16 @@
 
 namespace fs = std::filesystem;
 
+//How the latest attempt at calculating a metric went, if it failed; a successful one just leaves its score.
+//Stored in the score file next to the scores, as lines of the form "!<metric>=<STATUS> <seconds>", which
+//getAllScores() never includes.
+struct MetricOutcome
+{
+    enum Status { OK, ERROR, TIMEOUT, MEMOUT };
+    Status status;
+    double seconds; //wall time used
+    static std::string statusName(Status);
+};
 
 class MetricSet
 {
@@ -16,12 +26,18 @@ class MetricSet
         bool exists(std::string) const;
         double getScore(std::string) const;
         void setScore(std::string, double);
+        bool hasOutcome(std::string) const;
+        const MetricOutcome& getOutcome(std::string) const;
+        void setOutcome(std::string, MetricOutcome);
+        void clearOutcome(std::string);
         void save() const;
         void clear();
         const std::map<std::string, double>& getAllScores() const;
+        const std::map<std::string, MetricOutcome>& getAllOutcomes() const;
     private:
         fs::path scoreFilePath;
         std::map<std::string, double> metricScores;
+        std::map<std::string, MetricOutcome> metricOutcomes;
 };
 
 #endif
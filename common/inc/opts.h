@@ -8,5 +8,6 @@ extern po::variables_map opts;
 
 void addGraphFileOpts(po::options_description&);
 void addQuietVerboseOpts(po::options_description& desc);
+void addJobsOpts(po::options_description& desc, std::string);
 void addHelpAndConfOpts(po::options_description&, std::string);
 #endif
@@ -0,0 +1,35 @@
+#ifndef PROCESSLAUNCHER_H
+#define PROCESSLAUNCHER_H
+
+#include <string>
+#include <vector>
+#include <spawn.h>
+#include <sys/types.h>
+
+//Starts a program with posix_spawn(). Unlike fork(), whose cost grows with the size of the process (every page table
+//is copied, then every page either side touches takes a copy-on-write fault until the exec), this costs the same
+//however much memory we hold: glibc runs the child on our memory with vfork semantics until it execs. The argument
+//vector, environment and file actions are all built when the launcher is made, so nothing is allocated in the child,
+//and one launcher can start any number of children.
+//posix_spawn() only returns once the child has exec'd, so a program that can't be executed is reported by start().
+//The child gets the default SIGPIPE disposition even if we ignore it.
+class ProcessLauncher
+{
+    public:
+        ProcessLauncher(const std::vector<std::string>& argv);
+        ~ProcessLauncher();
+        ProcessLauncher(const ProcessLauncher&) = delete;
+        ProcessLauncher& operator=(const ProcessLauncher&) = delete;
+        void redirect(int childFd, int parentFd); //the child's childFd becomes a copy of our parentFd, close-on-exec or not
+        void newProcessGroup(); //the child leads a process group of its own, from before it execs
+        pid_t start() const; //throws std::system_error if the program can't be started
+        static int wait(pid_t pid); //reaps that child (and no other), returning its wait status, or -1
+    private:
+        std::vector<std::string> argv;
+        std::vector<char*> args;
+        posix_spawn_file_actions_t actions;
+        posix_spawnattr_t attributes;
+        short flags = 0;
+};
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef RUNTIMEESTIMATOR_H
+#define RUNTIMEESTIMATOR_H
+
+#include <map>
+#include <vector>
+#include <string>
+#include <utility>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+//Predicts the CPU time a solver will need for a problem on a graph, so that benchmarks can be started longest
+//first. Learns from the .stat files of every previous benchmark run of the solver in the store:
+//  - if the solver has already been run on this problem and graph, the average time taken is used;
+//  - otherwise, a log-linear regression of the time on the graph's Size, Sparseness and SCC-Count scores
+//    (as calculated by graph_analyser), fitted to the previous runs of the same problem, or of any problem
+//    if there are too few of those, is used;
+//  - failing that (no scores, or too little history), there is no estimate.
+//Runs that timed out count as having taken the full time limit, if it is longer. Not safe to use from several
+//threads at once.
+class RuntimeEstimator
+{
+    public:
+        enum Source { NONE, HISTORY, REGRESSION };
+        struct Estimate
+        {
+            Source source;
+            double seconds;
+        };
+
+        RuntimeEstimator(const fs::path& storeDir, const std::string& solver, double timeLimit = 0);
+        Estimate estimate(const std::string& hash, const std::string& fullproblem) const; //fullproblem as in the .stat file name, e.g. DC-PR:5
+        size_t historySize() const; //number of distinct (graph, problem) pairs with previous runs
+    private:
+        typedef std::vector<double> Features;
+        typedef std::vector<double> Model; //regression coefficients, one per feature; empty if there's none
+
+        bool features(const std::string& hash, Features& out) const; //false if the graph lacks a score
+        static Model fit(const std::vector<std::pair<Features, double>>& samples);
+
+        fs::path scoresDir;
+        std::map<std::pair<std::string, std::string>, double> history; //(hash, fullproblem) -> average seconds
+        std::map<std::string, Model> problemModels; //by problem, without the argument
+        Model globalModel;
+        mutable std::map<std::string, std::pair<bool, Features>> featureCache;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef SCC_H
+#define SCC_H
+
+#include <vector>
+#include <cstdint>
+#include "graph.h"
+
+//Strongly connected components of a graph's attack relation. Computed with an iterative version of
+//Tarjan's algorithm over the CSR index, so long attack chains can't overflow the stack, and all state
+//is local to the object, so several graphs can be decomposed concurrently.
+//Components are numbered in the order Tarjan's algorithm completes them, i.e. in reverse topological
+//order: a component is only attacked by components with higher numbers.
+class SCCDecomposition
+{
+    public:
+        SCCDecomposition(const Graph&);
+        int32_t count() const;
+        int32_t componentOf(int32_t arg) const;
+        const std::vector<int32_t>& components() const; //component of every argument
+        const std::vector<int32_t>& sizes() const; //number of arguments in every component
+    private:
+        std::vector<int32_t> component;
+        std::vector<int32_t> componentSizes;
+};
+
+#endif
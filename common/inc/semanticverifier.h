@@ -0,0 +1,84 @@
+#ifndef SEMANTICVERIFIER_H
+#define SEMANTICVERIFIER_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <cstdint>
+#include <filesystem>
+#include "graph.h"
+#include "grounded.h"
+
+namespace fs = std::filesystem;
+
+//Checks a solver's output against the semantics, straight from the graph, with no reference solution: every
+//extension output for an enumeration problem (EE, SE), or as the witness of a decision (after YES for DC, after
+//NO for DS), must really be one. An extension is checked in time linear in the graph for complete and stable
+//semantics, and in the attacks on and by its arguments for admissible semantics; for grounded semantics, it is
+//compared with the grounded labelling, worked out once. Whether every extension was found, or a maximal one,
+//can't be told this way (except for grounded semantics, having just the one); that takes a reference solution.
+class SemanticVerifier
+{
+    public:
+        enum Semantics { ADMISSIBLE, COMPLETE, STABLE, GROUNDED };
+        struct Result
+        {
+            long valid = 0;
+            long invalid = 0;
+            std::vector<long> invalidIndices; //positions in the output of the first few invalid extensions
+        };
+        static const size_t maxReportedInvalid = 10;
+
+        //verify() for output that arrives in chunks (e.g. read from a solver's pipe) rather than as a file: each
+        //extension is checked as soon as its ']' arrives, so only the one being read is ever held. The verifier
+        //must outlive it.
+        class Check
+        {
+            public:
+                //source only names the output in error messages. Throws std::runtime_error as verify() does,
+                //as do feed() and finish().
+                Check(const SemanticVerifier& verifier, const std::string& problem, const std::string& argument, const fs::path& source);
+                void feed(std::string_view chunk);
+                Result finish();
+            private:
+                enum Phase { WORD, SCAN, DONE };
+                void decide();
+                void scan(std::string_view chunk, size_t i);
+                void addName(std::string_view name);
+                void endExtension();
+
+                const SemanticVerifier& verifier;
+                fs::path source;
+                std::string task;
+                Semantics semantics;
+                int32_t argId = -1;
+                int extensionDepth;
+                Phase phase = WORD;
+                std::string word; //the first word, or as much of it as tells it isn't YES or NO
+                size_t wordOffset = 0;
+                size_t offset = 0; //of the next chunk in the output
+                int depth = 0;
+                std::vector<int32_t> members;
+                bool unknown = false; //an argument not in the graph
+                std::string name; //a name spanning chunks
+                long index = 0;
+                Result result;
+        };
+
+        //True for the problems (e.g. EE-ST, DC-CO) whose output can be verified
+        static bool supports(const std::string& problem);
+        SemanticVerifier(const Graph& graph);
+        //For problems that take an argument, it's given by name. Throws std::runtime_error if the output can't
+        //be read, or isn't in the ICCMA format.
+        Result verify(const fs::path& output, const std::string& problem, const std::string& argument = "") const;
+        //members may hold duplicates
+        bool isExtension(const std::vector<int32_t>& members, Semantics semantics) const;
+    private:
+        const Graph& graph;
+        std::unordered_map<std::string_view, int32_t> ids; //views into the graph's names
+        mutable std::unique_ptr<GroundedLabelling> grounded; //only once needed
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SUBPROCESS_H
+#define SUBPROCESS_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sys/types.h>
+
+//Resource limits enforced on a Subprocess while we wait for its output. 0 means unlimited.
+//They apply to the child's whole process group, so wrapper scripts can't escape them.
+struct ResourceLimits
+{
+    double wallSeconds = 0;
+    double cpuSeconds = 0;
+    size_t memoryMB = 0; //resident memory
+    bool any() const { return wallSeconds > 0 || cpuSeconds > 0 || memoryMB > 0; }
+};
+
+//A child process with pipes connected to its stdin and stdout, for line-based conversations.
+//Unlike pstreams, every pipe end is created close-on-exec, so children started concurrently (or later)
+//never inherit each other's pipes - which would otherwise stop them from ever seeing end-of-file.
+//Creating a Subprocess makes the whole process ignore SIGPIPE, so that writing to a child that has
+//died shows up as a failed write rather than killing us.
+//The child runs in its own process group. If it exceeds its limits while we're reading from it, the
+//whole group is killed and the read fails, with limitHit() saying why.
+class Subprocess
+{
+    public:
+        enum LimitHit { NONE, WALL_TIME, CPU_TIME, MEMORY };
+
+        Subprocess(const std::vector<std::string>& argv, ResourceLimits limits = {}); //throws std::system_error if the program can't be started
+        ~Subprocess(); //closes both pipes and reaps the child
+        Subprocess(const Subprocess&) = delete;
+        Subprocess& operator=(const Subprocess&) = delete;
+        bool writeLine(const std::string& line); //false if the child no longer reads its input
+        bool readLine(std::string& line); //false on end-of-file before a full line
+        bool readToEnd(std::string& out); //false if the limits were hit first
+        void closeInput();
+        int wait(); //closes both pipes and returns the wait status
+        void startClock(); //limits count from here; called on construction, and e.g. before each request to a long-lived child
+        double elapsed() const; //wall seconds since startClock()
+        LimitHit limitHit() const;
+        pid_t pid() const;
+    private:
+        bool awaitOutput(); //blocks until our end of stdout is readable, or kills the child if it exceeds the limits
+        pid_t child = -1;
+        int inFd = -1; //our end of the child's stdin
+        int outFd = -1; //our end of the child's stdout
+        bool reaped = false;
+        int status = 0;
+        std::string readBuffer;
+        ResourceLimits limits;
+        LimitHit hit = NONE;
+        std::chrono::steady_clock::time_point clockStart;
+        double cpuStart = 0;
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef TGFPARSER_H
+#define TGFPARSER_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+//Contents of a TGF file as read by scanTgf. Names are views into the scanned buffer, which must outlive this.
+struct TgfContents
+{
+    std::vector<std::string_view> names; //every distinct name, declared or only mentioned in an attack, sorted
+    std::vector<bool> declared; //whether names[i] appears in the argument section
+    std::vector<uint64_t> attacks; //(source << 32 | target) as indices into names, sorted, without duplicates
+};
+
+bool scanTgf(std::string_view data, const std::string& path, TgfContents& out);
+std::string tgfHash(const TgfContents&);
+
+#endif
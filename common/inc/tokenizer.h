@@ -0,0 +1,42 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <string_view>
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+//A set of up to maxChars delimiter bytes, for use with TokenStream
+class DelimiterSet
+{
+    public:
+        static constexpr size_t maxChars = 8;
+        DelimiterSet(std::string_view delimiters);
+        bool contains(char c) const { return table[(unsigned char)c]; }
+        const std::array<char, maxChars>& chars() const { return members; }
+        size_t count() const { return memberCount; }
+    private:
+        std::array<bool, 256> table {};
+        std::array<char, maxChars> members {};
+        size_t memberCount = 0;
+};
+
+extern const DelimiterSet whitespaceDelimiters; //the characters operator>> separates on in the "C" locale
+
+//Splits a buffer into tokens separated by runs of delimiters. The buffer is classified 64 bytes at a
+//time into a bitmask of delimiter positions (with AVX2, SSE2 or scalar code, chosen at startup), and
+//tokens are then found with bit scans, so every byte is only looked at once.
+class TokenStream
+{
+    public:
+        TokenStream(std::string_view data, const DelimiterSet& delims);
+        std::string_view next(); //an empty view means there are no more tokens
+    private:
+        void load();
+        const char* block;
+        const char* end;
+        const DelimiterSet& delims;
+        uint64_t delimMask; //bit i set if block[i] is a delimiter, already consumed, or past the end
+};
+
+#endif
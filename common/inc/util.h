@@ -1,9 +1,33 @@
+#ifndef UTIL_H
+#define UTIL_H
 #include <string>
 #include <memory>
 #include <vector>
+#include <set>
 #include "graph.h"
+#include "graphhashset.h"
+
+//A distinct graph (by hash) among the input files, and every file holding it
+struct UniqueGraph
+{
+    std::string hash;
+    std::string path; //the first file with this hash, which stands in for the others
+    std::vector<std::string> duplicates; //the other files
+};
 
 std::vector<std::string> get_graphlist();
 std::set<std::string> get_graphset();
 Graph* parseFile(std::string path);
+//Like parseFile, but goes through the store's graph cache: with a known hash, a cached snapshot is used if
+//there is one, and a freshly parsed graph is cached for next time (unless --no-graph-cache is set)
+Graph* loadGraph(std::string path, std::string knownHash = "");
+//The hash parseFile would give the graph, without building it; empty if the graph file can't be parsed
+std::string hashFile(std::string path);
+//Hashes every file in parallel, reusing the hash cache for unchanged files and updating it with the rest.
+//An empty hash means the file couldn't be parsed (which is reported). With snapshot set, new graphs are
+//fully loaded rather than just hashed, so that a graph cache snapshot is left behind for later use.
+std::vector<std::string> hashGraphs(const std::vector<std::string>& graphFiles, GraphHashSet& ghset, bool useHashCache, unsigned jobs, bool snapshot = false);
+//Groups files by hash, in order of first appearance, leaving out those with no hash
+std::vector<UniqueGraph> dedupeGraphs(const std::vector<std::string>& graphFiles, const std::vector<std::string>& hashes);
 std::string getAdditionalArg(std::string, std::string);
+#endif
@@ -0,0 +1,36 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <functional>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <exception>
+
+//Runs a batch of independent tasks on a fixed number of threads. Tasks are dealt out round-robin to
+//per-worker queues; each worker takes from the front of its own queue and, once that is empty, steals
+//from the back of the others'. With a single thread, tasks run in submission order on the caller's thread.
+class WorkPool
+{
+    public:
+        WorkPool(unsigned threads); //0 means one thread per available core
+        void submit(std::function<void()> task);
+        void run(); //blocks until every submitted task has finished, then rethrows the first exception thrown by a task, if any
+        unsigned size() const;
+    private:
+        struct Queue
+        {
+            std::mutex lock;
+            std::deque<std::function<void()>> tasks;
+        };
+        bool take(unsigned worker, std::function<void()>& task);
+        void work(unsigned worker);
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        unsigned nextQueue = 0;
+        std::mutex errorLock;
+        std::exception_ptr firstError;
+};
+
+#endif
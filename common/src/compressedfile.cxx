@@ -0,0 +1,198 @@
+#include <cstring>
+#include <algorithm>
+#include <climits>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "compressedfile.h"
+#include "mappedfile.h"
+
+namespace
+{
+    const unsigned char gzipMagic[2] = { 0x1f, 0x8b };
+    const size_t chunkSize = 1 << 20;
+    const unsigned bufferSize = 1 << 18; //zlib's own, for reading or writing the file
+
+    //The message for zlib's last error on the file, which zlib starts with the file's name
+    std::string errorOf(gzFile in, const fs::path& file)
+    {
+        int code;
+        const char* message = gzerror(in, &code);
+        return (code == Z_ERRNO? file.string() + ": " + std::strerror(errno) : message);
+    }
+}
+
+bool isCompressed(const fs::path& file)
+{
+    unsigned char magic[sizeof(gzipMagic)];
+    std::ifstream in(file, std::ios::binary);
+    return in.read(reinterpret_cast<char*>(magic), sizeof(magic)) && std::memcmp(magic, gzipMagic, sizeof(magic)) == 0;
+}
+
+//Any number of concatenated gzip members are read, as gzip itself does
+void readChunks(const fs::path& file, const std::function<void(std::string_view)>& onChunk)
+{
+    if (!isCompressed(file))
+    {   MappedFile map(file.string());
+        onChunk(map.view());
+        return;
+    }
+
+    gzFile in = gzopen(file.c_str(), "rbe");
+    if (!in)
+    {   throw std::runtime_error("Unable to open " + file.string());
+    }
+    gzbuffer(in, bufferSize);
+    std::vector<char> buffer(chunkSize);
+    try
+    {   for (int n; (n = gzread(in, buffer.data(), buffer.size())) != 0; )
+        {   if (n < 0)
+            {   throw std::runtime_error("Unable to decompress " + errorOf(in, file));
+            }
+            onChunk(std::string_view(buffer.data(), n));
+        }
+        int code;
+        gzerror(in, &code);
+        if (code != Z_OK) //e.g. a truncated file
+        {   throw std::runtime_error("Unable to decompress " + errorOf(in, file));
+        }
+    }
+    catch (...)
+    {   gzclose(in);
+        throw;
+    }
+    gzclose(in);
+}
+
+//Only the last member's size is recorded at the end; files written here have just the one
+std::uintmax_t textSize(const fs::path& file)
+{
+    std::uintmax_t size = fs::file_size(file);
+    unsigned char trailer[4];
+    std::ifstream in(file, std::ios::binary);
+    if (size < 18 || !isCompressed(file) || !in.seekg(-4, std::ios::end) || !in.read(reinterpret_cast<char*>(trailer), sizeof(trailer)))
+    {   return size;
+    }
+    std::uintmax_t recorded = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((std::uintmax_t)trailer[3] << 24);
+    return std::max(recorded, size);
+}
+
+//zlib reads a plain file as it is
+bool startsWith(const fs::path& file, std::string_view prefix)
+{
+    gzFile in = gzopen(file.c_str(), "rbe");
+    if (!in)
+    {   return false;
+    }
+    std::string start(prefix.size(), '\0');
+    bool starts = gzread(in, start.data(), start.size()) == (int)start.size() && start == prefix;
+    gzclose(in);
+    return starts;
+}
+
+std::string readFirstLine(const fs::path& file)
+{
+    if (!isCompressed(file))
+    {   std::ifstream in(file);
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+    std::string line;
+    gzFile in = gzopen(file.c_str(), "rbe");
+    if (in)
+    {   for (int c; (c = gzgetc(in)) >= 0 && c != '\n'; )
+        {   line += (char)c;
+        }
+        gzclose(in);
+    }
+    return line;
+}
+
+bool compressFile(const fs::path& file)
+{
+    if (isCompressed(file))
+    {   return true;
+    }
+    //unique per process and thread, as for the caches beside solutions
+    fs::path tmp = file;
+    tmp += ".tmp-" + std::to_string(getpid()) + "-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    bool written = false;
+    try
+    {   CompressedWriter writer(tmp);
+        MappedFile map(file.string());
+        written = writer.write(map.view()) && writer.close();
+    }
+    catch (std::runtime_error& e)
+    {   written = false;
+    }
+    std::error_code ec;
+    if (written)
+    {   fs::rename(tmp, file, ec);
+    }
+    if (!written || ec)
+    {   fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+CompressedWriter::CompressedWriter(const fs::path& file, int level) : file(file)
+{
+    std::string mode = "wbe" + std::to_string(level);
+    out = gzopen(file.c_str(), mode.c_str());
+    if (!out)
+    {   throw std::runtime_error("Unable to create " + file.string() + ": " + std::strerror(errno));
+    }
+    gzbuffer(out, bufferSize);
+}
+
+CompressedWriter::~CompressedWriter()
+{
+    if (out)
+    {   gzclose(out);
+    }
+}
+
+//gzwrite() takes at most UINT_MAX bytes at a time
+bool CompressedWriter::write(std::string_view data)
+{
+    while (!failed && !data.empty())
+    {   unsigned n = (unsigned)std::min<size_t>(data.size(), UINT_MAX / 2);
+        if (gzwrite(out, data.data(), n) != (int)n)
+        {   fail(errorOf(out, file));
+        }
+        data.remove_prefix(n);
+    }
+    return !failed;
+}
+
+bool CompressedWriter::close()
+{
+    if (!out)
+    {   return !failed;
+    }
+    int code = gzclose(out); //which frees it, so gzerror() can't be asked
+    out = nullptr;
+    if (code != Z_OK)
+    {   fail(file.string() + ": " + (code == Z_ERRNO? std::strerror(errno) : zError(code)));
+    }
+    return !failed;
+}
+
+const std::string& CompressedWriter::error() const
+{
+    return failure;
+}
+
+//Only the first failure is kept, as the rest follow from it
+void CompressedWriter::fail(const std::string& message)
+{
+    if (!failed)
+    {   failure = message;
+    }
+    failed = true;
+}
@@ -0,0 +1,217 @@
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <cerrno>
+#include <climits>
+#include <fstream>
+#include <sstream>
+#include <tuple>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include "coreslots.h"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+const int MPOL_BIND_MODE = 2; //MPOL_BIND, from <numaif.h>, which only comes with libnuma
+
+struct Cpu
+{
+    int id;
+    int node = 0;
+    int package = 0;
+    int core;
+    int siblingRank = 0; //0 for the first hyperthread of its physical core, 1 for the second, ...
+};
+
+int readInt(const fs::path& file, int fallback)
+{
+    std::ifstream in(file);
+    int value;
+    return (in >> value)? value : fallback;
+}
+
+//Parses the kernel's CPU and node list format, e.g. "0-3,8,10-11"
+std::vector<int> readList(const fs::path& file)
+{
+    std::vector<int> ids;
+    std::ifstream in(file);
+    std::string range;
+    while (std::getline(in, range, ','))
+    {   std::istringstream r(range);
+        int first, last;
+        if (!(r >> first))
+        {   continue;
+        }
+        last = first;
+        if (r.get() == '-')
+        {   r >> last;
+        }
+        for (int id = first; id <= last; id++)
+        {   ids.push_back(id);
+        }
+    }
+    return ids;
+}
+
+std::vector<Cpu> allowedCpus()
+{
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    {   throw std::system_error(errno, std::generic_category(), "Unable to read the CPU affinity");
+    }
+
+    std::vector<int> nodeOf(CPU_SETSIZE, 0);
+    std::error_code ec;
+    for (const fs::directory_entry& entry : fs::directory_iterator("/sys/devices/system/node", ec))
+    {   std::string name = entry.path().filename().string();
+        if (name.compare(0, 4, "node") != 0 || name.size() == 4 || !std::all_of(name.begin() + 4, name.end(), ::isdigit))
+        {   continue;
+        }
+        int node = std::stoi(name.substr(4));
+        for (int cpu : readList(entry.path() / "cpulist"))
+        {   if (cpu >= 0 && cpu < CPU_SETSIZE)
+            {   nodeOf[cpu] = node;
+            }
+        }
+    }
+
+    std::vector<Cpu> cpus;
+    for (int id = 0; id < CPU_SETSIZE; id++)
+    {   if (!CPU_ISSET(id, &allowed))
+        {   continue;
+        }
+        fs::path topology = fs::path("/sys/devices/system/cpu") / ("cpu" + std::to_string(id)) / "topology";
+        Cpu cpu;
+        cpu.id = id;
+        cpu.node = nodeOf[id];
+        cpu.package = readInt(topology / "physical_package_id", 0);
+        cpu.core = readInt(topology / "core_id", id);
+        std::vector<int> siblings = readList(topology / "thread_siblings_list");
+        cpu.siblingRank = std::count_if(siblings.begin(), siblings.end(), [id](int s) { return s < id; });
+        cpus.push_back(cpu);
+    }
+    return cpus;
+}
+
+void pinTo(const CoreSlot& slot)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : slot.cpus)
+    {   CPU_SET(cpu, &set);
+    }
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0)
+    {   throw std::system_error(err, std::generic_category(), "Unable to pin to " + slot.describe());
+    }
+}
+
+}
+
+std::string CoreSlot::describe() const
+{
+    std::string desc = "CPU";
+    desc += (cpus.size() == 1? " " : "s ");
+    for (size_t i = 0; i < cpus.size(); i++)
+    {   desc += (i == 0? "" : ",") + std::to_string(cpus[i]);
+    }
+    if (node >= 0)
+    {   desc += " (NUMA node " + std::to_string(node) + ")";
+    }
+    return desc;
+}
+
+std::vector<CoreSlot> allocateCoreSlots(unsigned slots, unsigned coresPerSlot, bool numa)
+{
+    coresPerSlot = std::max(1u, coresPerSlot);
+    std::vector<Cpu> cpus = allowedCpus();
+    int nodes = 0;
+    for (const Cpu& cpu : cpus)
+    {   nodes = std::max(nodes, cpu.node + 1);
+    }
+    numa = numa && nodes > 1;
+
+    //one group of CPUs per node (or a single group), in the order they're handed out
+    std::vector<std::vector<Cpu>> groups(numa? nodes : 1);
+    for (const Cpu& cpu : cpus)
+    {   groups[numa? cpu.node : 0].push_back(cpu);
+    }
+    for (std::vector<Cpu>& group : groups)
+    {   std::sort(group.begin(), group.end(), [](const Cpu& a, const Cpu& b)
+            {   return std::tie(a.siblingRank, a.node, a.package, a.core, a.id) < std::tie(b.siblingRank, b.node, b.package, b.core, b.id);
+            });
+    }
+
+    //deal out whole slots from each group in turn
+    std::vector<CoreSlot> allocated;
+    std::vector<size_t> used(groups.size(), 0);
+    for (bool progress = true; progress && (slots == 0 || allocated.size() < slots); )
+    {   progress = false;
+        for (size_t g = 0; g < groups.size() && (slots == 0 || allocated.size() < slots); g++)
+        {   if (groups[g].size() - used[g] < coresPerSlot)
+            {   continue;
+            }
+            CoreSlot slot;
+            for (unsigned i = 0; i < coresPerSlot; i++)
+            {   slot.cpus.push_back(groups[g][used[g]++].id);
+            }
+            std::sort(slot.cpus.begin(), slot.cpus.end());
+            slot.node = numa? groups[g].front().node : -1;
+            allocated.push_back(slot);
+            progress = true;
+        }
+    }
+    return allocated;
+}
+
+void bindToSlot(const CoreSlot& slot)
+{
+    pinTo(slot);
+
+    if (slot.node >= 0)
+    {   const size_t bits = sizeof(unsigned long) * CHAR_BIT;
+        std::vector<unsigned long> mask(slot.node / bits + 1, 0);
+        mask[slot.node / bits] |= 1UL << (slot.node % bits);
+        //the kernel reads one bit less than maxnode says
+        if (syscall(SYS_set_mempolicy, MPOL_BIND_MODE, mask.data(), mask.size() * bits + 1) != 0)
+        {   throw std::system_error(errno, std::generic_category(), "Unable to bind memory to NUMA node " + std::to_string(slot.node));
+        }
+    }
+}
+
+CoreSlot spareCpus(const std::vector<CoreSlot>& slots)
+{
+    std::vector<bool> taken(CPU_SETSIZE, false);
+    for (const CoreSlot& slot : slots)
+    {   for (int cpu : slot.cpus)
+        {   taken[cpu] = true;
+        }
+    }
+    CoreSlot spare;
+    for (const Cpu& cpu : allowedCpus())
+    {   if (!taken[cpu.id])
+        {   spare.cpus.push_back(cpu.id);
+        }
+    }
+    return spare;
+}
+
+TemporaryPinning::TemporaryPinning(const CoreSlot& slot)
+{
+    int err = pthread_getaffinity_np(pthread_self(), sizeof(previous), &previous);
+    if (err != 0)
+    {   throw std::system_error(err, std::generic_category(), "Unable to read the CPU affinity");
+    }
+    pinTo(slot);
+}
+
+TemporaryPinning::~TemporaryPinning()
+{
+    pthread_setaffinity_np(pthread_self(), sizeof(previous), &previous);
+}
@@ -0,0 +1,928 @@
+#include <fstream>
+#include <cstring>
+#include <thread>
+#include <memory>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+#include "extensionset.h"
+#include "compressedfile.h"
+#include "graphhashset.h"
+#include "mappedfile.h"
+#include "tokenizer.h"
+#include "SpookyV2.h"
+
+namespace
+{
+    const DelimiterSet extensionDelimiters(" ,:[]\n\r\t");
+
+    const char cacheMagic[8] = { 'A', 'F', 'E', 'X', 'T', 'S', '\0', '\0' };
+    const uint32_t cacheVersion = 2;
+    //an encoded solution is laid out as a cache, of no other file
+    const char encodedMagic[8] = { 'A', 'F', 'E', 'X', 'T', 'S', 'O', 'L' };
+
+    //Followed by the sections below, in this order, each starting at a multiple of 8 bytes:
+    //nameOffsets, offsets (only if not dense), words, names
+    struct CacheHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t dense;
+        uint64_t sourceSize; //stamp of the solution file the cache was made from
+        int64_t sourceMtimeNs;
+        uint64_t sourceInode;
+        uint64_t nameCount;
+        uint64_t nameBytes;
+        uint64_t extensionCount;
+        uint64_t wordCount;
+        uint64_t width;
+    };
+
+    size_t padded(size_t bytes)
+    {
+        return (bytes + 7) & ~(size_t)7;
+    }
+
+    struct CacheLayout
+    {
+        size_t nameOffsets, offsets, words, names, total;
+
+        CacheLayout(const CacheHeader& h)
+        {
+            nameOffsets = sizeof(CacheHeader);
+            offsets = nameOffsets + (h.nameCount + 1) * sizeof(uint64_t);
+            words = offsets + (h.dense? 0 : (h.extensionCount + 1) * sizeof(uint64_t));
+            names = words + padded(h.wordCount * sizeof(uint32_t));
+            total = names + h.nameBytes;
+        }
+    };
+
+    struct FingerprintRecord
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t reserved;
+        uint64_t sourceSize;
+        int64_t sourceMtimeNs;
+        uint64_t sourceInode;
+        uint64_t count;
+        uint64_t sum[2];
+    };
+
+    const char fingerprintMagic[8] = { 'A', 'F', 'E', 'X', 'F', 'P', '\0', '\0' };
+    const uint32_t fingerprintVersion = 1;
+    const uint64_t nameSeed = 0x9e3779b97f4a7c15ull;
+    const uint64_t extensionSeeds[2] = { 0xc2b2ae3d27d4eb4full, 0x165667b19e3779f9ull };
+
+    fs::path cacheFileOf(const fs::path& file, const char* suffix)
+    {
+        fs::path cacheFile = file;
+        cacheFile += suffix;
+        return cacheFile;
+    }
+
+    bool sameSource(const FileStamp& stamp, uint64_t size, int64_t mtimeNs, uint64_t inode)
+    {
+        return stamp.valid && stamp.size == size && stamp.mtimeNs == mtimeNs && stamp.inode == inode;
+    }
+
+    //Writes a cache file atomically (via a temporary file and a rename); write() fills in the stream. False if
+    //it couldn't be written.
+    template <typename F> bool writeAtomically(const fs::path& cacheFile, F write)
+    {
+        //unique per process and thread, so concurrent writers of the same cache never share a temporary file
+        fs::path tmp = cacheFile;
+        tmp += ".tmp-" + std::to_string(getpid()) + "-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        {   std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out)
+            {   return false;
+            }
+            write(out);
+            if (!out.flush())
+            {   std::error_code ec;
+                fs::remove(tmp, ec);
+                return false;
+            }
+        }
+        std::error_code ec;
+        fs::rename(tmp, cacheFile, ec);
+        if (ec)
+        {   fs::remove(tmp, ec);
+        }
+        return !ec;
+    }
+
+    //The file is split at every ']'. The first piece holds the opening bracket of the whole list followed by that
+    //of the first extension (or only the one bracket, for a lone extension); every later piece, one extension,
+    //from its '['. Reading stops at the list's closing bracket, i.e. an empty (or blank) piece, or when no ']' is
+    //left. onExtension is given the text of each extension, from its '['. readPiece() takes one piece, whose ']'
+    //is at offset close in the file, and returns false at the closing bracket.
+    template <typename F> bool readPiece(std::string_view piece, bool first, size_t close, const fs::path& file, F& onExtension)
+    {
+        size_t open = piece.find('[');
+        if (first && open != std::string_view::npos)
+        {   size_t inner = piece.find('[', open + 1);
+            open = (inner == std::string_view::npos? open : inner);
+        }
+        if (open == std::string_view::npos && piece.find_first_not_of(" ,\n\r\t") == std::string_view::npos)
+        {   return false; //the list's closing bracket, on a line of its own; compare-extensions used to crash here
+        }
+        else if (open == std::string_view::npos)
+        {   throw std::runtime_error("Invalid solution file " + file.string() + ": expected '[' before offset " + std::to_string(close));
+        }
+        onExtension(piece.substr(open));
+        return true;
+    }
+
+    //The file is read a chunk at a time, decompressed if need be; an encoded one is loaded and its extensions
+    //written out again
+    template <typename F> void forEachExtension(const fs::path& file, F onExtension)
+    {
+        if (ExtensionSet::isEncoded(file))
+        {   ExtensionSet::loadReference(file).forEachText(onExtension);
+            return;
+        }
+        ExtensionSplitter splitter(file, onExtension);
+        readChunks(file, [&splitter](std::string_view chunk) { splitter.feed(chunk); });
+    }
+}
+
+bool ExtensionSet::Extension::operator==(const Extension& other) const
+{
+    return count == other.count && std::memcmp(words, other.words, count * sizeof(uint32_t)) == 0;
+}
+
+//Any total order does, as long as both sets use the same one
+bool ExtensionSet::Extension::operator<(const Extension& other) const
+{
+    if (count != other.count)
+    {   return count < other.count;
+    }
+    return std::memcmp(words, other.words, count * sizeof(uint32_t)) < 0;
+}
+
+size_t ExtensionSet::size() const
+{
+    return stored() + foreign;
+}
+
+size_t ExtensionSet::stored() const
+{
+    return dense? words.size() / width : offsets.size() - 1;
+}
+
+ExtensionSet::Extension ExtensionSet::extension(size_t i) const
+{
+    if (dense)
+    {   return { words.data() + i * width, width };
+    }
+    return { words.data() + offsets[i], offsets[i + 1] - offsets[i] };
+}
+
+//Extensions are laid out as sorted ids while reading, and only turned into bitsets once they've all been read
+ExtensionSet ExtensionSet::parse(const fs::path& file, const ExtensionSet* reference)
+{
+    ExtensionSet set;
+    set.offsets.push_back(0);
+    std::string name;
+    forEachExtension(file, [&](std::string_view text)
+    {   bool isForeign = false;
+        TokenStream tokens(text, extensionDelimiters);
+        for (std::string_view token = tokens.next(); !token.empty(); token = tokens.next())
+        {   name.assign(token.data(), token.size());
+            if (reference)
+            {   auto known = reference->ids.find(name);
+                if (known == reference->ids.end())
+                {   isForeign = true;
+                }
+                else
+                {   set.words.push_back(known->second);
+                }
+                continue;
+            }
+            auto inserted = set.ids.emplace(name, set.names.size());
+            if (inserted.second)
+            {   set.names.push_back(name);
+            }
+            set.words.push_back(inserted.first->second);
+        }
+
+        auto begin = set.words.begin() + set.offsets.back();
+        if (isForeign)
+        {   set.words.erase(begin, set.words.end());
+            set.foreign++;
+            return;
+        }
+        std::sort(begin, set.words.end());
+        set.words.erase(std::unique(begin, set.words.end()), set.words.end());
+        set.offsets.push_back(set.words.size());
+    });
+
+    //offsets take two words each
+    size_t width = (set.names.size() + 31) / 32;
+    if (reference? reference->dense : (width > 0 && set.stored() * width < set.words.size() + 2 * set.offsets.size()))
+    {   set.encodeDense(reference? reference->width : width);
+    }
+    set.sortExtensions();
+    return set;
+}
+
+void ExtensionSet::encodeDense(size_t bitsetWidth)
+{
+    std::vector<uint32_t> bitsets(stored() * bitsetWidth, 0);
+    for (size_t i = 0; i < stored(); i++)
+    {   uint32_t* bitset = bitsets.data() + i * bitsetWidth;
+        for (uint64_t w = offsets[i]; w < offsets[i + 1]; w++)
+        {   bitset[words[w] / 32] |= 1u << (words[w] % 32);
+        }
+    }
+    words.swap(bitsets);
+    offsets.clear();
+    offsets.shrink_to_fit();
+    width = bitsetWidth;
+    dense = true;
+}
+
+void ExtensionSet::sortExtensions()
+{
+    std::vector<size_t> order(stored());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](size_t a, size_t b) { return extension(a) < extension(b); });
+
+    std::vector<uint32_t> sorted;
+    sorted.reserve(words.size());
+    std::vector<uint64_t> sortedOffsets;
+    if (!dense)
+    {   sortedOffsets.reserve(offsets.size());
+        sortedOffsets.push_back(0);
+    }
+    for (size_t i : order)
+    {   Extension e = extension(i);
+        sorted.insert(sorted.end(), e.words, e.words + e.count);
+        if (!dense)
+        {   sortedOffsets.push_back(sorted.size());
+        }
+    }
+    words.swap(sorted);
+    if (!dense)
+    {   offsets.swap(sortedOffsets);
+    }
+}
+
+ExtensionSet ExtensionSet::loadReference(const fs::path& file)
+{
+    ExtensionSet set;
+    if (isEncoded(file))
+    {   if (!set.readArena(file, nullptr))
+        {   throw std::runtime_error("Invalid encoded solution file " + file.string());
+        }
+        return set;
+    }
+    fs::path cacheFile = cacheFileOf(file, ".exts");
+    if (set.readArena(cacheFile, &file))
+    {   return set;
+    }
+    set = parse(file);
+    set.writeCache(cacheFile, file);
+    if (isCompressed(file) && fs::exists(cacheFile))
+    {   compressFile(cacheFile); //or it would take more room than the solution
+    }
+    return set;
+}
+
+//A cache is only used for as long as its solution file is unchanged. An encoded solution or a cache may be
+//compressed, and is then read into memory whole first.
+bool ExtensionSet::readArena(const fs::path& arenaFile, const fs::path* source)
+{
+    std::unique_ptr<MappedFile> map;
+    std::string decompressed;
+    std::string_view arena;
+    try
+    {   if (isCompressed(arenaFile))
+        {   readChunks(arenaFile, [&decompressed](std::string_view chunk) { decompressed.append(chunk); });
+            arena = decompressed;
+        }
+        else
+        {   map = std::make_unique<MappedFile>(arenaFile.string(), false);
+            arena = map->view();
+        }
+    }
+    catch (std::runtime_error& e)
+    {   return false;
+    }
+    if (arena.size() < sizeof(CacheHeader))
+    {   return false;
+    }
+
+    const char* base = arena.data();
+    const CacheHeader& header = *reinterpret_cast<const CacheHeader*>(base);
+    if (std::memcmp(header.magic, source? cacheMagic : encodedMagic, sizeof(cacheMagic)) != 0 || header.version != cacheVersion
+        || (source && !sameSource(FileStamp::of(source->string()), header.sourceSize, header.sourceMtimeNs, header.sourceInode)))
+    {   return false;
+    }
+    CacheLayout layout(header);
+    if (layout.total != arena.size())
+    {   return false;
+    }
+    const uint64_t* nameOffsets = reinterpret_cast<const uint64_t*>(base + layout.nameOffsets);
+    const uint64_t* extensionOffsets = reinterpret_cast<const uint64_t*>(base + layout.offsets);
+    const uint32_t* wordData = reinterpret_cast<const uint32_t*>(base + layout.words);
+    if (nameOffsets[header.nameCount] != header.nameBytes || (header.dense && header.width == 0)
+        || (header.dense? header.extensionCount * header.width : extensionOffsets[header.extensionCount]) != header.wordCount)
+    {   return false;
+    }
+
+    names.reserve(header.nameCount);
+    for (uint64_t i = 0; i < header.nameCount; i++)
+    {   names.emplace_back(base + layout.names + nameOffsets[i], nameOffsets[i + 1] - nameOffsets[i]);
+        ids.emplace(names.back(), i);
+    }
+    dense = header.dense;
+    width = header.width;
+    words.assign(wordData, wordData + header.wordCount);
+    if (!dense)
+    {   offsets.assign(extensionOffsets, extensionOffsets + header.extensionCount + 1);
+    }
+    return true;
+}
+
+//Written atomically (via a temporary file and a rename), and only for solution files that have stopped
+//changing; failing to write it just means parsing again next time
+void ExtensionSet::writeCache(const fs::path& cacheFile, const fs::path& file) const
+{
+    FileStamp stamp = FileStamp::of(file.string());
+    if (!stamp.valid || stamp.recent())
+    {   return;
+    }
+    writeAtomically(cacheFile, [&](std::ofstream& out) { writeArena(out, cacheMagic, stamp); });
+}
+
+void ExtensionSet::writeArena(std::ostream& out, const char* magic, const FileStamp& source) const
+{
+    std::vector<uint64_t> nameOffsets { 0 };
+    for (const std::string& name : names)
+    {   nameOffsets.push_back(nameOffsets.back() + name.size());
+    }
+    CacheHeader header;
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = cacheVersion;
+    header.dense = dense;
+    header.sourceSize = source.size;
+    header.sourceMtimeNs = source.mtimeNs;
+    header.sourceInode = source.inode;
+    header.nameCount = names.size();
+    header.nameBytes = nameOffsets.back();
+    header.extensionCount = stored();
+    header.wordCount = words.size();
+    header.width = width;
+
+    static const char zeros[8] = {};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(nameOffsets.data()), nameOffsets.size() * sizeof(uint64_t));
+    if (!dense)
+    {   out.write(reinterpret_cast<const char*>(offsets.data()), offsets.size() * sizeof(uint64_t));
+    }
+    out.write(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(uint32_t));
+    out.write(zeros, padded(words.size() * sizeof(uint32_t)) - words.size() * sizeof(uint32_t));
+    for (const std::string& name : names)
+    {   out.write(name.data(), name.size());
+    }
+}
+
+//Caches made from the text are of no more use once it's replaced
+void ExtensionSet::encode(const fs::path& file)
+{
+    if (isEncoded(file))
+    {   return;
+    }
+    ExtensionSet set = parse(file);
+    if (!writeAtomically(file, [&set](std::ofstream& out) { set.writeArena(out, encodedMagic, FileStamp()); }))
+    {   throw std::runtime_error("Unable to write encoded solution file " + file.string());
+    }
+    std::error_code ec;
+    fs::remove(cacheFileOf(file, ".exts"), ec);
+}
+
+bool ExtensionSet::isEncoded(const fs::path& file)
+{
+    return startsWith(file, std::string_view(encodedMagic, sizeof(encodedMagic)));
+}
+
+//Arguments are written in id order, which is as good as any
+void ExtensionSet::forEachText(const std::function<void(std::string_view)>& onExtension) const
+{
+    std::string text;
+    for (size_t i = 0; i < stored(); i++)
+    {   Extension e = extension(i);
+        text.assign("[");
+        auto add = [&](uint32_t id)
+        {   text.append(text.size() > 1? "," : "").append(names[id]);
+        };
+        for (size_t w = 0; w < e.count; w++)
+        {   if (!dense)
+            {   add(e.words[w]);
+                continue;
+            }
+            for (uint32_t bits = e.words[w]; bits != 0; bits &= bits - 1)
+            {   add(w * 32 + __builtin_ctz(bits));
+            }
+        }
+        onExtension(text);
+    }
+}
+
+//The solutions' extensions are matched up in a single merge; an extension listed several times only
+//matches as many copies in the other solution
+ExtensionComparison compareExtensions(const ExtensionSet& reference, const ExtensionSet& candidate)
+{
+    long correct = 0;
+    size_t ref = 0, cand = 0;
+    while (ref < reference.stored() && cand < candidate.stored())
+    {   ExtensionSet::Extension r = reference.extension(ref);
+        ExtensionSet::Extension c = candidate.extension(cand);
+        if (r == c)
+        {   correct++;
+            ref++;
+            cand++;
+        }
+        else if (r < c)
+        {   ref++;
+        }
+        else
+        {   cand++;
+        }
+    }
+    long total = reference.size();
+    long candidates = candidate.size();
+    return { total == candidates && correct == total, total, correct, candidates - correct };
+}
+
+ExtensionSplitter::ExtensionSplitter(const fs::path& source, std::function<void(std::string_view)> onExtension)
+    : source(source), onExtension(std::move(onExtension))
+{
+}
+
+//As soon as the ']' of an extension spanning chunks arrives, it's read from the buffer, and the rest of the
+//chunk straight from the chunk
+void ExtensionSplitter::feed(std::string_view chunk)
+{
+    if (finished)
+    {   return;
+    }
+    if (!pending.empty())
+    {   size_t close = chunk.find(']');
+        if (close == std::string_view::npos)
+        {   pending.append(chunk);
+            return;
+        }
+        pending.append(chunk.substr(0, close + 1));
+        consume(pending);
+        offset += pending.size();
+        pending.clear();
+        chunk.remove_prefix(close + 1);
+    }
+    size_t used = consume(chunk);
+    offset += used;
+    if (!finished)
+    {   pending.assign(chunk.substr(used));
+    }
+}
+
+//Reads every piece of text whose ']' it holds; returns how much that was
+size_t ExtensionSplitter::consume(std::string_view text)
+{
+    size_t pos = 0;
+    for (size_t close; !finished && (close = text.find(']', pos)) != std::string_view::npos; pos = close + 1)
+    {   finished = (close == pos || !readPiece(text.substr(pos, close - pos), first, offset + close, source, onExtension));
+        first = false;
+    }
+    return pos;
+}
+
+ExtensionStream::ExtensionStream(const ExtensionSet& reference, const fs::path& source)
+    : reference(reference), splitter(source, [this](std::string_view extension) { match(extension); }), matched(reference.stored(), 0)
+{
+}
+
+void ExtensionStream::feed(std::string_view chunk)
+{
+    splitter.feed(chunk);
+}
+
+//The extension is encoded as the reference's are and looked up by binary search; of a run of equal extensions
+//in the reference, only as many can be matched as the run is long
+void ExtensionStream::match(std::string_view extension)
+{
+    candidates++;
+    ids.clear();
+    TokenStream tokens(extension, extensionDelimiters);
+    for (std::string_view token = tokens.next(); !token.empty(); token = tokens.next())
+    {   name.assign(token.data(), token.size());
+        auto known = reference.ids.find(name);
+        if (known == reference.ids.end())
+        {   return; //an argument the reference never mentions
+        }
+        ids.push_back(known->second);
+    }
+    std::sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    ExtensionSet::Extension e { ids.data(), ids.size() };
+    if (reference.dense)
+    {   bitset.assign(reference.width, 0);
+        for (uint32_t id : ids)
+        {   bitset[id / 32] |= 1u << (id % 32);
+        }
+        e = { bitset.data(), bitset.size() };
+    }
+
+    size_t lo = 0, hi = reference.stored();
+    while (lo < hi)
+    {   size_t mid = lo + (hi - lo) / 2;
+        if (reference.extension(mid) < e)
+        {   lo = mid + 1;
+        }
+        else
+        {   hi = mid;
+        }
+    }
+    if (lo == reference.stored() || !(reference.extension(lo) == e))
+    {   return;
+    }
+    size_t end = lo + 1;
+    for (hi = reference.stored(); end < hi; )
+    {   size_t mid = end + (hi - end) / 2;
+        if (e < reference.extension(mid))
+        {   hi = mid;
+        }
+        else
+        {   end = mid + 1;
+        }
+    }
+    if (matched[lo] < end - lo)
+    {   matched[lo]++;
+        correct++;
+    }
+}
+
+ExtensionComparison ExtensionStream::finish() const
+{
+    long total = reference.size();
+    return { total == candidates && correct == total, total, correct, candidates - correct };
+}
+
+//Duplicate arguments are dropped and the rest sorted (by hash), so an extension hashes the same however it's
+//written; the extensions' hashes are then added up, so their order doesn't matter either, but how many times
+//each is listed does
+ExtensionFingerprint ExtensionFingerprint::of(const fs::path& file)
+{
+    ExtensionFingerprint fingerprint;
+    std::vector<uint64_t> hashes;
+    forEachExtension(file, [&](std::string_view text)
+    {   hashes.clear();
+        TokenStream tokens(text, extensionDelimiters);
+        for (std::string_view token = tokens.next(); !token.empty(); token = tokens.next())
+        {   hashes.push_back(SpookyHash::Hash64(token.data(), token.size(), nameSeed));
+        }
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+        uint64 h1 = extensionSeeds[0], h2 = extensionSeeds[1];
+        SpookyHash::Hash128(hashes.data(), hashes.size() * sizeof(uint64_t), &h1, &h2);
+        fingerprint.sum[0] += h1;
+        fingerprint.sum[1] += h2 + (fingerprint.sum[0] < h1); //with the carry
+        fingerprint.count++;
+    });
+    return fingerprint;
+}
+
+ExtensionFingerprint ExtensionFingerprint::loadReference(const fs::path& file)
+{
+    fs::path cacheFile = cacheFileOf(file, ".fp");
+    FingerprintRecord record;
+    std::ifstream in(cacheFile, std::ios::binary);
+    if (in.read(reinterpret_cast<char*>(&record), sizeof(record)) && in.peek() == std::ifstream::traits_type::eof()
+        && std::memcmp(record.magic, fingerprintMagic, sizeof(fingerprintMagic)) == 0 && record.version == fingerprintVersion
+        && sameSource(FileStamp::of(file.string()), record.sourceSize, record.sourceMtimeNs, record.sourceInode))
+    {   ExtensionFingerprint fingerprint;
+        fingerprint.count = record.count;
+        fingerprint.sum[0] = record.sum[0];
+        fingerprint.sum[1] = record.sum[1];
+        return fingerprint;
+    }
+
+    ExtensionFingerprint fingerprint = of(file);
+    FileStamp stamp = FileStamp::of(file.string());
+    if (stamp.valid && !stamp.recent())
+    {   std::memcpy(record.magic, fingerprintMagic, sizeof(fingerprintMagic));
+        record.version = fingerprintVersion;
+        record.reserved = 0;
+        record.sourceSize = stamp.size;
+        record.sourceMtimeNs = stamp.mtimeNs;
+        record.sourceInode = stamp.inode;
+        record.count = fingerprint.count;
+        record.sum[0] = fingerprint.sum[0];
+        record.sum[1] = fingerprint.sum[1];
+        writeAtomically(cacheFile, [&record](std::ofstream& out) { out.write(reinterpret_cast<const char*>(&record), sizeof(record)); });
+    }
+    return fingerprint;
+}
+
+bool ExtensionFingerprint::operator==(const ExtensionFingerprint& other) const
+{
+    return count == other.count && sum[0] == other.sum[0] && sum[1] == other.sum[1];
+}
+
+namespace
+{
+    typedef std::vector<uint32_t> Ids;
+
+    const size_t maxFanIn = 64; //runs merged at once
+    const size_t runBufferSize = 256 * 1024;
+
+    //Same order as ExtensionSet::Extension's
+    bool idsLess(const Ids& a, const Ids& b)
+    {
+        if (a.size() != b.size())
+        {   return a.size() < b.size();
+        }
+        return std::memcmp(a.data(), b.data(), a.size() * sizeof(uint32_t)) < 0;
+    }
+
+    //A run is a file of extensions in sorted order, each as its number of ids followed by the ids
+    class RunReader
+    {
+        public:
+            RunReader(const fs::path& file) : buffer(runBufferSize)
+            {
+                in.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+                in.open(file, std::ios::binary);
+                if (!in)
+                {   throw std::runtime_error("Unable to read temporary file " + file.string());
+                }
+            }
+
+            bool next(Ids& ids)
+            {
+                uint32_t count;
+                if (!in.read(reinterpret_cast<char*>(&count), sizeof(count)))
+                {   return false;
+                }
+                ids.resize(count);
+                if (!in.read(reinterpret_cast<char*>(ids.data()), count * sizeof(uint32_t)))
+                {   throw std::runtime_error("Truncated temporary file");
+                }
+                return true;
+            }
+        private:
+            std::vector<char> buffer;
+            std::ifstream in;
+    };
+
+    class RunWriter
+    {
+        public:
+            RunWriter(const fs::path& file) : buffer(runBufferSize)
+            {
+                out.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+                out.open(file, std::ios::binary | std::ios::trunc);
+                if (!out)
+                {   throw std::runtime_error("Unable to create temporary file " + file.string());
+                }
+            }
+
+            void write(const uint32_t* ids, uint32_t count)
+            {
+                out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+                out.write(reinterpret_cast<const char*>(ids), count * sizeof(uint32_t));
+            }
+
+            void close()
+            {
+                if (!out.flush())
+                {   throw std::runtime_error("Unable to write temporary file (out of disk space?)");
+                }
+                out.close();
+            }
+        private:
+            std::vector<char> buffer;
+            std::ofstream out;
+    };
+
+    //Yields the extensions of several runs as a single sorted sequence
+    class RunMerger
+    {
+        public:
+            RunMerger(const std::vector<fs::path>& runs)
+            {
+                for (const fs::path& run : runs)
+                {   readers.push_back(std::make_unique<RunReader>(run));
+                }
+                current.resize(runs.size());
+                for (size_t i = 0; i < readers.size(); i++)
+                {   if (readers[i]->next(current[i]))
+                    {   heap.push_back(i);
+                    }
+                }
+                std::make_heap(heap.begin(), heap.end(), after());
+            }
+
+            bool next(Ids& ids)
+            {
+                if (heap.empty())
+                {   return false;
+                }
+                std::pop_heap(heap.begin(), heap.end(), after());
+                size_t i = heap.back();
+                ids.swap(current[i]);
+                if (readers[i]->next(current[i]))
+                {   std::push_heap(heap.begin(), heap.end(), after());
+                }
+                else
+                {   heap.pop_back();
+                }
+                return true;
+            }
+        private:
+            //orders readers for a max-heap, so that the one with the smallest extension is on top
+            struct After
+            {
+                const std::vector<Ids>& current;
+                bool operator()(size_t a, size_t b) const { return idsLess(current[b], current[a]); }
+            };
+            After after() const
+            {
+                return { current };
+            }
+
+            std::vector<std::unique_ptr<RunReader>> readers; //not movable, as they hold on to their buffers
+            std::vector<Ids> current;
+            std::vector<size_t> heap;
+    };
+
+    //Collects extensions into memory until the limit, then writes them out sorted as a run
+    class RunSpiller
+    {
+        public:
+            RunSpiller(const fs::path& dir, const std::string& prefix, size_t memoryLimit)
+                : dir(dir), prefix(prefix), memoryLimit(memoryLimit), offsets { 0 } {
+            }
+
+            void add(const uint32_t* ids, size_t count)
+            {
+                words.insert(words.end(), ids, ids + count);
+                offsets.push_back(words.size());
+                //the words, plus an offset and a place in the sort order per extension
+                if (words.size() * sizeof(uint32_t) + offsets.size() * 2 * sizeof(uint64_t) >= memoryLimit)
+                {   spill();
+                }
+            }
+
+            //Returns no more than maxFanIn runs, merging some together if need be
+            std::vector<fs::path> finish()
+            {
+                if (offsets.size() > 1 || runs.empty())
+                {   spill();
+                }
+                std::vector<uint32_t>().swap(words);
+                std::vector<uint64_t>().swap(offsets);
+                while (runs.size() > maxFanIn)
+                {   std::vector<fs::path> group(runs.begin(), runs.begin() + maxFanIn);
+                    runs.erase(runs.begin(), runs.begin() + maxFanIn);
+                    RunMerger merger(group);
+                    RunWriter writer(nextRun());
+                    for (Ids ids; merger.next(ids);)
+                    {   writer.write(ids.data(), ids.size());
+                    }
+                    writer.close();
+                    for (const fs::path& run : group)
+                    {   fs::remove(run);
+                    }
+                }
+                return runs;
+            }
+        private:
+            fs::path nextRun()
+            {
+                runs.push_back(dir / (prefix + std::to_string(runCount++)));
+                return runs.back();
+            }
+
+            void spill()
+            {
+                size_t count = offsets.size() - 1;
+                std::vector<size_t> order(count);
+                std::iota(order.begin(), order.end(), 0);
+                std::sort(order.begin(), order.end(), [this](size_t a, size_t b)
+                    {   size_t lengthA = offsets[a + 1] - offsets[a], lengthB = offsets[b + 1] - offsets[b];
+                        if (lengthA != lengthB)
+                        {   return lengthA < lengthB;
+                        }
+                        return std::memcmp(words.data() + offsets[a], words.data() + offsets[b], lengthA * sizeof(uint32_t)) < 0;
+                    });
+                RunWriter writer(nextRun());
+                for (size_t i : order)
+                {   writer.write(words.data() + offsets[i], offsets[i + 1] - offsets[i]);
+                }
+                writer.close();
+                words.clear();
+                offsets.resize(1);
+            }
+
+            fs::path dir;
+            std::string prefix;
+            size_t memoryLimit;
+            size_t runCount = 0;
+            std::vector<fs::path> runs;
+            std::vector<uint32_t> words;
+            std::vector<uint64_t> offsets;
+    };
+
+    //A directory of its own for the runs, removed with everything in it however the comparison ends
+    struct TemporaryDirectory
+    {
+        fs::path path;
+
+        TemporaryDirectory(const fs::path& parent)
+            : path(parent / (".extsort-" + std::to_string(getpid()) + "-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()))))
+        {
+            fs::create_directories(path);
+        }
+
+        ~TemporaryDirectory()
+        {
+            std::error_code ec;
+            fs::remove_all(path, ec);
+        }
+    };
+}
+
+//Reads the reference and then the candidate into sorted runs, ids assigned as the reference's names are first
+//seen, then merges the runs of each and matches the two resulting sequences up as compareExtensions() does
+ExtensionComparison compareExtensionFiles(const fs::path& referenceFile, const fs::path& candidateFile, size_t memoryLimit, const fs::path& tmpDir)
+{
+    TemporaryDirectory tmp(tmpDir);
+    std::unordered_map<std::string, uint32_t> ids;
+    std::string name;
+    Ids extension;
+
+    long total = 0;
+    std::vector<fs::path> referenceRuns;
+    {   RunSpiller spiller(tmp.path, "reference-", memoryLimit);
+        forEachExtension(referenceFile, [&](std::string_view text)
+        {   extension.clear();
+            TokenStream tokens(text, extensionDelimiters);
+            for (std::string_view token = tokens.next(); !token.empty(); token = tokens.next())
+            {   name.assign(token.data(), token.size());
+                extension.push_back(ids.emplace(name, ids.size()).first->second);
+            }
+            std::sort(extension.begin(), extension.end());
+            extension.erase(std::unique(extension.begin(), extension.end()), extension.end());
+            spiller.add(extension.data(), extension.size());
+            total++;
+        });
+        referenceRuns = spiller.finish();
+    }
+
+    long candidates = 0;
+    std::vector<fs::path> candidateRuns;
+    {   RunSpiller spiller(tmp.path, "candidate-", memoryLimit);
+        forEachExtension(candidateFile, [&](std::string_view text)
+        {   candidates++;
+            extension.clear();
+            TokenStream tokens(text, extensionDelimiters);
+            for (std::string_view token = tokens.next(); !token.empty(); token = tokens.next())
+            {   name.assign(token.data(), token.size());
+                auto known = ids.find(name);
+                if (known == ids.end())
+                {   return; //can't be correct, so needn't be stored
+                }
+                extension.push_back(known->second);
+            }
+            std::sort(extension.begin(), extension.end());
+            extension.erase(std::unique(extension.begin(), extension.end()), extension.end());
+            spiller.add(extension.data(), extension.size());
+        });
+        candidateRuns = spiller.finish();
+    }
+
+    long correct = 0;
+    RunMerger reference(referenceRuns), candidate(candidateRuns);
+    Ids ref, cand;
+    bool moreRef = reference.next(ref), moreCand = candidate.next(cand);
+    while (moreRef && moreCand)
+    {   if (idsLess(ref, cand))
+        {   moreRef = reference.next(ref);
+        }
+        else if (idsLess(cand, ref))
+        {   moreCand = candidate.next(cand);
+        }
+        else
+        {   correct++;
+            moreRef = reference.next(ref);
+            moreCand = candidate.next(cand);
+        }
+    }
+    return { total == candidates && correct == total, total, correct, candidates - correct };
+}
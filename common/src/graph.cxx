@@ -4,9 +4,68 @@
 #include <iostream>
 #include <algorithm>
 #include <memory>
+#include <stdexcept>
 #include "graph.h"
 
-Graph::Graph(std::string infname) : infname(infname) {}
+namespace
+{
+    //Counting sort of the attacks into CSR form. Attacks keep their relative order within a row,
+    //so a graph whose attacks were added sorted by (source, target) has sorted rows in both directions.
+    void buildCSR(const std::vector<int32_t>& from, const std::vector<int32_t>& to, int32_t argCount,
+            std::vector<int32_t>& offsets, std::vector<int32_t>& targets)
+    {
+        offsets.assign(argCount + 1, 0);
+        for (int32_t f : from)
+        {   ++offsets[f + 1];
+        }
+        for (int32_t i = 0; i < argCount; i++)
+        {   offsets[i + 1] += offsets[i];
+        }
+
+        targets.resize(from.size());
+        std::vector<int32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < from.size(); i++)
+        {   targets[fill[from[i]]++] = to[i];
+        }
+    }
+}
+
+Graph::Graph(std::string infname) : infname(infname)
+{
+    bindData();
+}
+
+Graph::Graph()
+{
+    bindData();
+}
+
+Graph::Graph(std::string infname, GraphData data, std::shared_ptr<const void> owner) : infname(infname), storage(data), storageOwner(owner) {}
+
+void Graph::bindData()
+{
+    storage.names = nameData.data();
+    storage.nameBytes = nameData.size();
+    storage.nameOffsets = nameOffsets.data();
+    storage.argCount = nameOffsets.size() - 1;
+    storage.outOffsets = outOffsets.data();
+    storage.outTargets = outTargets.data();
+    storage.inOffsets = inOffsets.data();
+    storage.inSources = inSources.data();
+    storage.attackCount = outTargets.size();
+}
+
+void Graph::checkWritable() const
+{
+    if (storageOwner)
+    {   throw std::logic_error("Graph is backed by read-only storage and cannot be modified");
+    }
+}
+
+const GraphData& Graph::data() const
+{
+    return storage;
+}
 
 void Graph::setHash(std::string hash)
 {
@@ -20,7 +79,7 @@ std::string Graph::fname() const
 
 unsigned long Graph::size() const
 {
-    return args.size(); //currently not taking into account attack number
+    return argCount(); //currently not taking into account attack number
 }
 
 std::string Graph::hash() const
@@ -28,28 +87,72 @@ std::string Graph::hash() const
     return hashval;
 }
 
+int32_t Graph::argCount() const
+{
+    return storage.argCount;
+}
+
+size_t Graph::attackCount() const
+{
+    return storage.attackCount;
+}
+
+std::string_view Graph::argName(int32_t arg) const
+{
+    return std::string_view(storage.names + storage.nameOffsets[arg], storage.nameOffsets[arg + 1] - storage.nameOffsets[arg]);
+}
+
+ArgRange Graph::attacksFrom(int32_t arg) const
+{
+    return ArgRange(storage.outTargets + storage.outOffsets[arg], storage.outTargets + storage.outOffsets[arg + 1]);
+}
+
+ArgRange Graph::attackersOf(int32_t arg) const
+{
+    return ArgRange(storage.inSources + storage.inOffsets[arg], storage.inSources + storage.inOffsets[arg + 1]);
+}
+
 void Graph::printArgs() const
 {
-    for(auto a : args)
-    {   std::cout << a->name << ", ";
+    for (int32_t a = 0; a < argCount(); a++)
+    {   std::cout << argName(a) << ", ";
     }
     std::cout << std::endl;
 }
 
 const std::vector<std::shared_ptr<Argument>>& Graph::getArgs() const
 {
+    std::call_once(argsViewFlag, [this]()
+        {
+            args.reserve(argCount());
+            for (int32_t a = 0; a < argCount(); a++)
+            {   args.push_back(std::make_shared<Argument>(std::string(argName(a)), a));
+            }
+        });
     return args;
 }
 
 const std::vector<std::pair<std::shared_ptr<Argument>, std::shared_ptr<Argument>>>& Graph::getAttacks() const
 {
+    std::call_once(attacksViewFlag, [this]()
+        {
+            const std::vector<std::shared_ptr<Argument>>& argv = getArgs();
+            attacks.reserve(attackCount());
+            for (int32_t a = 0; a < argCount(); a++)
+            {   for (int32_t target : attacksFrom(a))
+                {   attacks.push_back(std::make_pair(argv[a], argv[target]));
+                }
+            }
+        });
     return attacks;
 }
 
 void Graph::printAttacks() const
 {
-    for (auto attack : attacks)
-    {   std::cout << attack.first->name << " attacks " << attack.second->name << std::endl;
+    for (int32_t a = 0; a < argCount(); a++)
+    {   for (int32_t target : attacksFrom(a))
+        {   std::cout << argName(a) << " attacks " << argName(target) << std::endl;
+        }
     }
 }
 
@@ -59,25 +162,61 @@ void Graph::printOut() const
     this->printAttacks();
 }
 
-void Graph::addArgument(std::shared_ptr<Argument> argument)
+void Graph::reserve(int32_t args, size_t nameBytes, size_t attacks)
 {
-    args.push_back(argument);
+    checkWritable();
+    nameData.reserve(nameBytes);
+    nameOffsets.reserve(args + 1);
+    pendingSources.reserve(attacks);
+    pendingTargets.reserve(attacks);
 }
 
-void Graph::addArgument(std::string name, int id)
+int32_t Graph::addArgument(std::string_view name)
 {
-    args.push_back(std::shared_ptr<Argument>(new Argument(name, id)));
+    checkWritable();
+    nameData.append(name);
+    nameOffsets.push_back(nameData.size());
+    bindData();
+    return argCount() - 1;
 }
 
-void Graph::addAttack(std::shared_ptr<Argument> source, std::shared_ptr<Argument> destination)
+void Graph::addAttack(int32_t source, int32_t destination)
 {
-    attacks.push_back(std::make_pair(source, destination));
+    checkWritable();
+    if (source < 0 || source >= argCount() || destination < 0 || destination >= argCount())
+    {   throw std::out_of_range("Attack refers to an argument index not present in the graph");
+    }
+    pendingSources.push_back(source);
+    pendingTargets.push_back(destination);
 }
 
-/* //see header - unusable performance, dubious utility
-void Graph::addAttack(std::string source, std::string destination) {
-    auto src = std::find_if(args.begin(), args.end(), [&source](auto ptr) { return *ptr == source; });
-    auto dest = std::find_if(args.begin(), args.end(), [&destination](std::shared_ptr<Argument> ptr) { return *ptr == destination; });
-    attacks.push_back(std::make_pair(*src, *dest));
+void Graph::buildIndex()
+{
+    if (storageOwner)
+    {   return; //borrowed storage is always fully indexed
+    }
+    if (pendingSources.empty() && outOffsets.size() == nameOffsets.size())
+    {   return; //already up to date
+    }
+    //fold any previously indexed attacks back in ahead of the new ones, so that the index can be extended
+    if (!outTargets.empty())
+    {   std::vector<int32_t> sources, targets;
+        sources.reserve(outTargets.size() + pendingSources.size());
+        targets.reserve(outTargets.size() + pendingTargets.size());
+        for (int32_t a = 0; a + 1 < (int32_t)outOffsets.size(); a++)
+        {   for (int32_t target : attacksFrom(a))
+            {   sources.push_back(a);
+                targets.push_back(target);
+            }
+        }
+        sources.insert(sources.end(), pendingSources.begin(), pendingSources.end());
+        targets.insert(targets.end(), pendingTargets.begin(), pendingTargets.end());
+        pendingSources.swap(sources);
+        pendingTargets.swap(targets);
+    }
+    buildCSR(pendingSources, pendingTargets, argCount(), outOffsets, outTargets);
+    buildCSR(pendingTargets, pendingSources, argCount(), inOffsets, inSources);
+    std::vector<int32_t>().swap(pendingSources);
+    std::vector<int32_t>().swap(pendingTargets);
+    bindData();
 }
-//*/
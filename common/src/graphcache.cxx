@@ -0,0 +1,147 @@
+#include <fstream>
+#include <cstring>
+#include <thread>
+#include <system_error>
+#include <unistd.h>
+#include "graphcache.h"
+#include "mappedfile.h"
+
+namespace
+{
+    const char snapshotMagic[8] = { 'A', 'F', 'G', 'R', 'A', 'P', 'H', '\0' };
+    const uint32_t snapshotVersion = 1;
+
+    //Followed by the sections below, in this order, each starting at a multiple of 8 bytes:
+    //hash, nameOffsets, outOffsets, outTargets, inOffsets, inSources, names
+    struct SnapshotHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t hashLength;
+        int32_t argCount;
+        uint32_t reserved;
+        uint64_t nameBytes;
+        uint64_t attackCount;
+    };
+
+    size_t padded(size_t bytes)
+    {
+        return (bytes + 7) & ~(size_t)7;
+    }
+
+    struct SnapshotLayout
+    {
+        size_t hash, nameOffsets, outOffsets, outTargets, inOffsets, inSources, names, total;
+
+        SnapshotLayout(const SnapshotHeader& h)
+        {
+            size_t offsetsBytes = padded((h.argCount + 1) * sizeof(int32_t));
+            size_t edgesBytes = padded(h.attackCount * sizeof(int32_t));
+            hash = sizeof(SnapshotHeader);
+            nameOffsets = hash + padded(h.hashLength);
+            outOffsets = nameOffsets + (h.argCount + 1) * sizeof(uint64_t);
+            outTargets = outOffsets + offsetsBytes;
+            inOffsets = outTargets + edgesBytes;
+            inSources = inOffsets + offsetsBytes;
+            names = inSources + edgesBytes;
+            total = names + h.nameBytes;
+        }
+    };
+
+    void writePadded(std::ofstream& out, const void* data, size_t bytes)
+    {
+        static const char zeros[8] = {};
+        out.write(static_cast<const char*>(data), bytes);
+        out.write(zeros, padded(bytes) - bytes);
+    }
+}
+
+bool writeGraphSnapshot(const Graph& graph, const fs::path& file)
+{
+    const GraphData& data = graph.data();
+    SnapshotHeader header;
+    std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.version = snapshotVersion;
+    header.hashLength = graph.hash().size();
+    header.argCount = data.argCount;
+    header.reserved = 0;
+    header.nameBytes = data.nameBytes;
+    header.attackCount = data.attackCount;
+
+    //unique per process and thread, so concurrent writers of the same snapshot never share a temporary file
+    fs::path tmp = file;
+    tmp += ".tmp-" + std::to_string(getpid()) + "-" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    {   std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {   return false;
+        }
+        size_t offsetsBytes = (data.argCount + 1) * sizeof(int32_t);
+        size_t edgesBytes = data.attackCount * sizeof(int32_t);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writePadded(out, graph.hash().data(), header.hashLength);
+        out.write(reinterpret_cast<const char*>(data.nameOffsets), (data.argCount + 1) * sizeof(uint64_t));
+        writePadded(out, data.outOffsets, offsetsBytes);
+        writePadded(out, data.outTargets, edgesBytes);
+        writePadded(out, data.inOffsets, offsetsBytes);
+        writePadded(out, data.inSources, edgesBytes);
+        out.write(data.names, data.nameBytes);
+        if (!out.flush())
+        {   std::error_code ec;
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, file, ec);
+    if (ec)
+    {   fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+std::unique_ptr<Graph> readGraphSnapshot(const fs::path& file, const std::string& graphFile, const std::string& hash)
+{
+    std::shared_ptr<MappedFile> map;
+    try
+    {   map = std::make_shared<MappedFile>(file.string(), false);
+    }
+    catch (std::system_error& e)
+    {   return nullptr;
+    }
+
+    //only the header and the ends of the offset tables are checked: snapshots are written atomically, so
+    //anything but a stale format or a foreign file would have to be deliberate tampering
+    if (map->size() < sizeof(SnapshotHeader))
+    {   return nullptr;
+    }
+    const char* base = map->data();
+    const SnapshotHeader& header = *reinterpret_cast<const SnapshotHeader*>(base);
+    if (std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) != 0 || header.version != snapshotVersion || header.argCount < 0)
+    {   return nullptr;
+    }
+    SnapshotLayout layout(header);
+    if (layout.total != map->size() || std::string_view(base + layout.hash, header.hashLength) != hash)
+    {   return nullptr;
+    }
+
+    GraphData data;
+    data.names = base + layout.names;
+    data.nameBytes = header.nameBytes;
+    data.nameOffsets = reinterpret_cast<const uint64_t*>(base + layout.nameOffsets);
+    data.argCount = header.argCount;
+    data.outOffsets = reinterpret_cast<const int32_t*>(base + layout.outOffsets);
+    data.outTargets = reinterpret_cast<const int32_t*>(base + layout.outTargets);
+    data.inOffsets = reinterpret_cast<const int32_t*>(base + layout.inOffsets);
+    data.inSources = reinterpret_cast<const int32_t*>(base + layout.inSources);
+    data.attackCount = header.attackCount;
+    if (data.nameOffsets[0] != 0 || data.nameOffsets[data.argCount] != data.nameBytes
+        || data.outOffsets[0] != 0 || (size_t)data.outOffsets[data.argCount] != data.attackCount
+        || data.inOffsets[0] != 0 || (size_t)data.inOffsets[data.argCount] != data.attackCount)
+    {   return nullptr;
+    }
+
+    std::unique_ptr<Graph> graph = std::make_unique<Graph>(graphFile, data, map);
+    graph->setHash(hash);
+    return graph;
+}
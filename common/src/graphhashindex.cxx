@@ -0,0 +1,149 @@
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <unistd.h>
+#include "graphhashindex.h"
+
+namespace
+{
+    const char indexMagic[8] = { 'A', 'F', 'H', 'I', 'D', 'X', '1', '\0' };
+
+    //Followed by the entries sorted by hash, then the same entries sorted by path, then the strings they point into
+    struct IndexHeader
+    {
+        char magic[8];
+        uint64_t count;
+        uint64_t stringBytes;
+    };
+}
+
+bool GraphHashIndex::write(const fs::path& file, std::vector<std::pair<std::string, std::string>> pathsAndHashes)
+{
+    std::sort(pathsAndHashes.begin(), pathsAndHashes.end());
+    std::string strings;
+    std::vector<Entry> byPathEntries;
+    byPathEntries.reserve(pathsAndHashes.size());
+    for (auto& entry : pathsAndHashes)
+    {   Entry e { strings.size(), strings.size() + entry.first.size(), (uint32_t)entry.first.size(), (uint32_t)entry.second.size() };
+        strings += entry.first;
+        strings += entry.second;
+        byPathEntries.push_back(e);
+    }
+    auto str = [&strings](uint64_t offset, uint32_t length) { return std::string_view(strings.data() + offset, length); };
+    std::vector<Entry> byHashEntries(byPathEntries);
+    std::sort(byHashEntries.begin(), byHashEntries.end(), [&str](const Entry& a, const Entry& b)
+        {
+            std::string_view ha = str(a.hashOffset, a.hashLength), hb = str(b.hashOffset, b.hashLength);
+            return ha != hb? ha < hb : str(a.pathOffset, a.pathLength) < str(b.pathOffset, b.pathLength);
+        });
+
+    IndexHeader header;
+    std::memcpy(header.magic, indexMagic, sizeof(indexMagic));
+    header.count = byPathEntries.size();
+    header.stringBytes = strings.size();
+
+    fs::path tmp = file;
+    tmp += ".tmp-" + std::to_string(getpid());
+    {   std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out)
+        {   return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(byHashEntries.data()), byHashEntries.size() * sizeof(Entry));
+        out.write(reinterpret_cast<const char*>(byPathEntries.data()), byPathEntries.size() * sizeof(Entry));
+        out.write(strings.data(), strings.size());
+        if (!out.flush())
+        {   std::error_code ec;
+            fs::remove(tmp, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    fs::rename(tmp, file, ec);
+    if (ec)
+    {   fs::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+GraphHashIndex::GraphHashIndex(const fs::path& file) : map(std::make_unique<MappedFile>(file.string(), false))
+{
+    if (map->size() < sizeof(IndexHeader))
+    {   throw std::runtime_error("Hash index " + file.string() + " is truncated");
+    }
+    const IndexHeader& header = *reinterpret_cast<const IndexHeader*>(map->data());
+    if (std::memcmp(header.magic, indexMagic, sizeof(indexMagic)) != 0)
+    {   throw std::runtime_error(file.string() + " is not a hash index");
+    }
+    count = header.count;
+    stringBytes = header.stringBytes;
+    if (map->size() != sizeof(IndexHeader) + 2 * count * sizeof(Entry) + stringBytes)
+    {   throw std::runtime_error("Hash index " + file.string() + " is truncated");
+    }
+    byHash = reinterpret_cast<const Entry*>(map->data() + sizeof(IndexHeader));
+    byPath = byHash + count;
+    strings = reinterpret_cast<const char*>(byPath + count);
+    for (const Entry* e = byHash; e != byHash + 2 * count; e++)
+    {   if (e->pathOffset + e->pathLength > stringBytes || e->hashOffset + e->hashLength > stringBytes)
+        {   throw std::runtime_error("Hash index " + file.string() + " is corrupt");
+        }
+    }
+}
+
+std::string_view GraphHashIndex::path(const Entry& e) const
+{
+    return std::string_view(strings + e.pathOffset, e.pathLength);
+}
+
+std::string_view GraphHashIndex::hash(const Entry& e) const
+{
+    return std::string_view(strings + e.hashOffset, e.hashLength);
+}
+
+size_t GraphHashIndex::size() const
+{
+    return count;
+}
+
+std::vector<std::string_view> GraphHashIndex::pathsOf(std::string_view wanted) const
+{
+    const Entry* first = std::lower_bound(byHash, byHash + count, wanted, [this](const Entry& a, std::string_view b) { return hash(a) < b; });
+    const Entry* last = std::upper_bound(first, byHash + count, wanted, [this](std::string_view a, const Entry& b) { return a < hash(b); });
+    std::vector<std::string_view> ret;
+    for (const Entry* e = first; e != last; e++)
+    {   ret.push_back(path(*e));
+    }
+    return ret;
+}
+
+std::string_view GraphHashIndex::hashOf(std::string_view wanted) const
+{
+    const Entry* e = std::lower_bound(byPath, byPath + count, wanted, [this](const Entry& a, std::string_view b) { return path(a) < b; });
+    if (e == byPath + count || path(*e) != wanted)
+    {   return std::string_view();
+    }
+    return hash(*e);
+}
+
+std::vector<std::pair<std::string_view, std::vector<std::string_view>>> GraphHashIndex::duplicates() const
+{
+    std::vector<std::pair<std::string_view, std::vector<std::string_view>>> ret;
+    for (uint64_t i = 0; i < count;)
+    {   uint64_t j = i + 1;
+        while (j < count && hash(byHash[j]) == hash(byHash[i]))
+        {   j++;
+        }
+        if (j - i > 1)
+        {   std::vector<std::string_view> paths;
+            for (uint64_t k = i; k < j; k++)
+            {   paths.push_back(path(byHash[k]));
+            }
+            ret.emplace_back(hash(byHash[i]), std::move(paths));
+        }
+        i = j;
+    }
+    return ret;
+}
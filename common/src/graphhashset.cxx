@@ -1,10 +1,42 @@
 #include <exception>
 #include <stdexcept>
 #include <iostream>
+#include <sstream>
+#include <vector>
+#include <ctime>
+#include <sys/stat.h>
 #include "graphhashset.h"
+#include "graphhashindex.h"
 #include "opts.h"
 
-GraphHashSet::GraphHashSet()
+namespace
+{
+    //A file modified this recently may be modified again within the same mtime tick, without its stamp changing
+    constexpr int64_t racyWindowNs = 2000000000;
+}
+
+FileStamp FileStamp::of(const std::string& path)
+{
+    FileStamp stamp;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+    {   return stamp;
+    }
+    stamp.size = st.st_size;
+    stamp.mtimeNs = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    stamp.inode = st.st_ino;
+    stamp.valid = true;
+    return stamp;
+}
+
+bool FileStamp::recent() const
+{
+    timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec - mtimeNs < racyWindowNs;
+}
+
+GraphHashSet::GraphHashSet(bool trustUnstamped) : trustUnstamped(trustUnstamped)
 {
     fs::path hashmapfile (opts["store-path"].as<std::string>() + "/graphhashmap");
     if (!fs::exists(hashmapfile)) //no scores yet
@@ -13,28 +45,77 @@ GraphHashSet::GraphHashSet()
 
     std::ifstream infile(hashmapfile.c_str());
     if (!infile)
-    {   std::cerr << "WARNING: unable to open existing hash cache file " << hashmapfile.string() << ". Hashes will not be cached, and if the --use-hash-cache option was set, cache will still not be used." << std::endl;
+    {   std::cerr << "WARNING: unable to open existing hash cache file " << hashmapfile.string() << ". Hashes will not be cached, and the existing cache will not be used." << std::endl;
     }
 
-    for (std::string namebuff, hashbuff; std::getline(infile, namebuff, ' ') && std::getline(infile, hashbuff);)
-    {   hashmap[namebuff] = hashbuff;
+    //"<path> <hash> <size> <mtime_ns> <inode>", or "<path> <hash>" from before stamps were recorded.
+    //Fields are split off the end, so paths may contain spaces.
+    for (std::string line; std::getline(infile, line);)
+    {   std::vector<std::string> fields;
+        std::string rest = line;
+        for (int i = 0; i < 4; i++)
+        {   size_t space = rest.rfind(' ');
+            if (space == std::string::npos)
+            {   break;
+            }
+            fields.insert(fields.begin(), rest.substr(space + 1));
+            rest.resize(space);
+        }
+
+        Entry entry;
+        try
+        {   if (fields.size() == 4)
+            {   entry.stamp.size = std::stoull(fields[1]);
+                entry.stamp.mtimeNs = std::stoll(fields[2]);
+                entry.stamp.inode = std::stoull(fields[3]);
+                entry.stamp.valid = true;
+            }
+        }
+        catch (std::exception& e)
+        {   entry.stamp.valid = false;
+        }
+        if (!entry.stamp.valid) //an old style entry: only the last field is the hash
+        {   size_t space = line.rfind(' ');
+            if (space == std::string::npos)
+            {   continue;
+            }
+            rest = line.substr(0, space);
+            fields = { line.substr(space + 1) };
+        }
+        entry.hash = fields[0];
+        hashmap[rest] = entry;
     }
     infile.close();
 }
 
-bool GraphHashSet::exists(std::string graphFile) const
+std::string GraphHashSet::lookup(const std::string& graphFile, const FileStamp& current) const
 {
-    return hashmap.find(graphFile) != hashmap.end();
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = hashmap.find(graphFile);
+    if (it == hashmap.end())
+    {   return "";
+    }
+    const Entry& entry = it->second;
+    if (entry.stamp.valid? entry.stamp == current : trustUnstamped)
+    {   return entry.hash;
+    }
+    return "";
 }
 
-std::string GraphHashSet::getHash(std::string graphFile) const
+void GraphHashSet::setHash(std::string graphFile, std::string hash, FileStamp stamp)
 {
-    return hashmap.at(graphFile);
+    std::lock_guard<std::mutex> guard(lock);
+    if (!stamp.valid || stamp.recent())
+    {   hashmap.erase(graphFile); //nothing trustworthy to record, and any older entry is stale
+        return;
+    }
+    hashmap[graphFile] = Entry { hash, stamp };
 }
 
-void GraphHashSet::setHash(std::string graphFile, std::string hash)
+void GraphHashSet::remove(const std::string& graphFile)
 {
-    hashmap[graphFile] = hash;
+    std::lock_guard<std::mutex> guard(lock);
+    hashmap.erase(graphFile);
 }
 
 void GraphHashSet::save() const
@@ -45,8 +126,21 @@ void GraphHashSet::save() const
     {   std::cerr << "WARNING: unable to open hash cache file for writing: " << hashmappath << ". Hashes generated or modified during this run will not be cached." << std::endl;
     }
 
+    std::lock_guard<std::mutex> guard(lock);
+    std::vector<std::pair<std::string, std::string>> pathsAndHashes;
+    pathsAndHashes.reserve(hashmap.size());
     for (auto& entry : hashmap)
-    {   ofile << entry.first << ' ' << entry.second << std::endl;
+    {   ofile << entry.first << ' ' << entry.second.hash;
+        if (entry.second.stamp.valid)
+        {   ofile << ' ' << entry.second.stamp.size << ' ' << entry.second.stamp.mtimeNs << ' ' << entry.second.stamp.inode;
+        }
+        ofile << std::endl;
+        pathsAndHashes.emplace_back(entry.first, entry.second.hash);
     }
     ofile.close();
+
+    std::string indexpath = opts["store-path"].as<std::string>() + "/graphhashindex";
+    if (!GraphHashIndex::write(indexpath, std::move(pathsAndHashes)))
+    {   std::cerr << "WARNING: unable to write hash index file: " << indexpath << ". Lookups by hash will have to hash the graphs again." << std::endl;
+    }
 }
@@ -0,0 +1,96 @@
+#include "grounded.h"
+
+GroundedLabelling::GroundedLabelling(const Graph& graph) : argLabels(graph.argCount(), UNDEC)
+{
+    int32_t argCount = graph.argCount();
+    std::vector<int32_t> liveAttackers(argCount);
+    std::vector<int32_t> queue; //arguments labelled IN whose targets haven't been labelled OUT yet
+    for (int32_t arg = 0; arg < argCount; arg++)
+    {   liveAttackers[arg] = graph.attackersOf(arg).size();
+        if (liveAttackers[arg] == 0)
+        {   argLabels[arg] = IN;
+            queue.push_back(arg);
+        }
+    }
+
+    while (!queue.empty())
+    {   int32_t in = queue.back();
+        queue.pop_back();
+        ins++;
+        for (int32_t target : graph.attacksFrom(in))
+        {   if (argLabels[target] == OUT)
+            {   continue;
+            }
+            argLabels[target] = OUT; //can't have been IN, since it's attacked by an IN argument
+            outs++;
+            for (int32_t next : graph.attacksFrom(target))
+            {   if (argLabels[next] == UNDEC && --liveAttackers[next] == 0)
+                {   argLabels[next] = IN;
+                    queue.push_back(next);
+                }
+            }
+        }
+    }
+}
+
+GroundedLabelling::Label GroundedLabelling::label(int32_t arg) const
+{
+    return argLabels[arg];
+}
+
+const std::vector<GroundedLabelling::Label>& GroundedLabelling::labels() const
+{
+    return argLabels;
+}
+
+int32_t GroundedLabelling::inCount() const
+{
+    return ins;
+}
+
+int32_t GroundedLabelling::outCount() const
+{
+    return outs;
+}
+
+int32_t GroundedLabelling::undecCount() const
+{
+    return argLabels.size() - ins - outs;
+}
+
+bool isGroundedProblem(const std::string& problem)
+{
+    return problem == "DC-GR" || problem == "DS-GR" || problem == "SE-GR" || problem == "EE-GR" || problem == "CE-GR";
+}
+
+bool writeGroundedSolution(const GroundedLabelling& grounded, const Graph& graph, const std::string& problem, const std::string& argument, std::ostream& out)
+{
+    if (!isGroundedProblem(problem))
+    {   return false;
+    }
+    std::string task = problem.substr(0, 2);
+    if (task == "DC" || task == "DS") //credulous and sceptical acceptance are the same with a single extension
+    {   for (int32_t arg = 0; arg < graph.argCount(); arg++)
+        {   if (graph.argName(arg) == argument)
+            {   out << (grounded.label(arg) == GroundedLabelling::IN? "YES" : "NO") << "\n";
+                return true;
+            }
+        }
+        return false;
+    }
+    else if (task == "CE")
+    {   out << "1\n";
+        return true;
+    }
+
+    out << (task == "EE"? "[[" : "[");
+    bool first = true;
+    for (int32_t arg = 0; arg < graph.argCount(); arg++)
+    {   if (grounded.label(arg) == GroundedLabelling::IN)
+        {   out << (first? "" : ",") << graph.argName(arg);
+            first = false;
+        }
+    }
+    out << (task == "EE"? "]]" : "]") << "\n";
+    return true;
+}
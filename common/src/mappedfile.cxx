@@ -0,0 +1,55 @@
+#include <system_error>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mappedfile.h"
+
+MappedFile::MappedFile(const std::string& path, bool sequential)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {   throw std::system_error(errno, std::generic_category(), "Unable to open " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0)
+    {   int err = errno;
+        close(fd);
+        throw std::system_error(err, std::generic_category(), "Unable to stat " + path);
+    }
+    length = st.st_size;
+    if (length > 0) //mmap rejects empty mappings; an empty file is simply an empty view
+    {   void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {   int err = errno;
+            close(fd);
+            throw std::system_error(err, std::generic_category(), "Unable to map " + path);
+        }
+        madvise(map, length, sequential? MADV_SEQUENTIAL : MADV_WILLNEED);
+        addr = static_cast<const char*>(map);
+    }
+    close(fd); //the mapping keeps its own reference to the file
+}
+
+MappedFile::~MappedFile()
+{
+    if (addr)
+    {   munmap(const_cast<char*>(addr), length);
+    }
+}
+
+const char* MappedFile::data() const
+{
+    return addr;
+}
+
+size_t MappedFile::size() const
+{
+    return length;
+}
+
+std::string_view MappedFile::view() const
+{
+    return std::string_view(addr, length);
+}
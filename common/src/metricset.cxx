@@ -1,8 +1,28 @@
 #include <exception>
 #include <stdexcept>
 #include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <iterator>
 #include "metricset.h"
 
+namespace
+{
+    const char outcomePrefix = '!';
+    const MetricOutcome::Status allStatuses[] = { MetricOutcome::OK, MetricOutcome::ERROR, MetricOutcome::TIMEOUT, MetricOutcome::MEMOUT };
+}
+
+std::string MetricOutcome::statusName(Status status)
+{
+    switch (status)
+    {   case OK: return "OK";
+        case ERROR: return "ERROR";
+        case TIMEOUT: return "TIMEOUT";
+        case MEMOUT: return "MEMOUT";
+    }
+    return "";
+}
+
 MetricSet::MetricSet(fs::path scorefile) : scoreFilePath(scorefile)
 {
     if (!fs::exists(scorefile)) //no scores yet
@@ -14,8 +34,29 @@ MetricSet::MetricSet(fs::path scorefile) : scoreFilePath(scorefile)
     {   throw std::runtime_error("Unable to open existing results file: " + scorefile.string());
     }
 
-    for (std::string namebuff, scorebuff; std::getline(infile, namebuff, '=') && std::getline(infile, scorebuff);)
-    {   try
+    for (std::string line; std::getline(infile, line);)
+    {   size_t eq = line.find('=');
+        if (eq == std::string::npos)
+        {   continue;
+        }
+        std::string namebuff = line.substr(0, eq);
+        std::string scorebuff = line.substr(eq + 1);
+        if (!namebuff.empty() && namebuff[0] == outcomePrefix)
+        {   std::istringstream fields(scorebuff);
+            std::string statusbuff;
+            MetricOutcome outcome { MetricOutcome::ERROR, 0 };
+            fields >> statusbuff >> outcome.seconds;
+            const MetricOutcome::Status* status = std::find_if(std::begin(allStatuses), std::end(allStatuses),
+                    [&statusbuff](MetricOutcome::Status s) { return MetricOutcome::statusName(s) == statusbuff; });
+            if (!fields || status == std::end(allStatuses))
+            {   std::cerr << "File " << scorefile.string() << " contains an invalid outcome for " << namebuff.substr(1) << ". Ignoring it." << std::endl;
+                continue;
+            }
+            outcome.status = *status;
+            metricOutcomes[namebuff.substr(1)] = outcome;
+            continue;
+        }
+        try
         {   metricScores[namebuff] = std::stod(scorebuff);
         }
         catch (std::exception& e)
@@ -41,6 +82,26 @@ void MetricSet::setScore(std::string metricName, double score)
     metricScores[metricName] = score;
 }
 
+bool MetricSet::hasOutcome(std::string metricName) const
+{
+    return metricOutcomes.find(metricName) != metricOutcomes.end();
+}
+
+const MetricOutcome& MetricSet::getOutcome(std::string metricName) const
+{
+    return metricOutcomes.at(metricName);
+}
+
+void MetricSet::setOutcome(std::string metricName, MetricOutcome outcome)
+{
+    metricOutcomes[metricName] = outcome;
+}
+
+void MetricSet::clearOutcome(std::string metricName)
+{
+    metricOutcomes.erase(metricName);
+}
+
 void MetricSet::save() const
 {
     std::ofstream ofile(scoreFilePath.c_str());
@@ -51,15 +112,24 @@ void MetricSet::save() const
     for (auto& entry : metricScores)
     {   ofile << entry.first << '=' << entry.second << std::endl;
     }
+    for (auto& entry : metricOutcomes)
+    {   ofile << outcomePrefix << entry.first << '=' << MetricOutcome::statusName(entry.second.status) << ' ' << entry.second.seconds << std::endl;
+    }
     ofile.close();
 }
 
 void MetricSet::clear()
 {
     metricScores.clear();
+    metricOutcomes.clear();
 }
 
 const std::map<std::string, double>& MetricSet::getAllScores() const
 {
     return metricScores;
 }
+
+const std::map<std::string, MetricOutcome>& MetricSet::getAllOutcomes() const
+{
+    return metricOutcomes;
+}
@@ -12,7 +12,9 @@ void addGraphFileOpts(po::options_description& desc)
         ("graphs,g", po::value<std::vector<std::string>>()->multitoken()->composing(), "A list of loose graph files. Disables the store.\n")
         ("graph-dirs,d", po::value<std::vector<std::string>>()->multitoken()->composing(), "A list of directories containing graph files. Disables the store.\n")
         ("use-store", po::bool_switch(), "Use the store's list of graphs despite the --graphs or --graph-dirs options being specified. (The union will be taken.)\nThis does nothing if neither of those options are also specified, as then the store is used by default.\n")
-        ("use-hash-cache,H", po::bool_switch(), "Use the cached hash map of graphs instead of recalculating the hash for every input file. This means that if one of the files was modified since the hash was last calculated, various results could end up wrong.\n");
+        ("no-hash-cache", po::bool_switch(), "Recalculate the hash of every input file, instead of reusing the hash cached in the store for files whose size, modification time and inode haven't changed since they were last hashed.\n")
+        ("use-hash-cache,H", po::bool_switch(), "Also trust cached hashes recorded by older versions, which didn't store the size, modification time and inode of the file, so can't tell if it was modified since the hash was calculated. If it was, various results could end up wrong.\n")
+        ("no-graph-cache", po::bool_switch(), "Do not read or write binary snapshots of parsed graphs in the store's graph-cache directory. Snapshots let graphs whose hash is already known be loaded without parsing them again.\n");
 }
 
 void addQuietVerboseOpts(po::options_description& desc)
@@ -22,6 +24,12 @@ void addQuietVerboseOpts(po::options_description& desc)
         ("quiet,q", po::bool_switch(), "Suppress all progress output, leaving only error and warning messages.\n");
 }
 
+void addJobsOpts(po::options_description& desc, std::string unit)
+{
+    desc.add_options()
+        ("jobs,j", po::value<unsigned>()->default_value(1), ("Number of " + unit + " to process in parallel. 0 uses one per available core.\n").c_str());
+}
+
 void addHelpAndConfOpts(po::options_description& desc, std::string default_conf_path)
 {
     desc.add_options()
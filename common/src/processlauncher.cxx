@@ -0,0 +1,66 @@
+#include <system_error>
+#include <cerrno>
+#include <csignal>
+#include <sys/wait.h>
+#include "processlauncher.h"
+
+extern char** environ;
+
+ProcessLauncher::ProcessLauncher(const std::vector<std::string>& argv) : argv(argv)
+{
+    for (std::string& arg : this->argv)
+    {   args.push_back(arg.data());
+    }
+    args.push_back(nullptr);
+
+    posix_spawn_file_actions_init(&actions);
+    posix_spawnattr_init(&attributes);
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attributes, &defaults);
+    flags = POSIX_SPAWN_SETSIGDEF;
+    posix_spawnattr_setflags(&attributes, flags);
+}
+
+ProcessLauncher::~ProcessLauncher()
+{
+    posix_spawnattr_destroy(&attributes);
+    posix_spawn_file_actions_destroy(&actions);
+}
+
+void ProcessLauncher::redirect(int childFd, int parentFd)
+{
+    int e = posix_spawn_file_actions_adddup2(&actions, parentFd, childFd);
+    if (e != 0)
+    {   throw std::system_error(e, std::generic_category(), "Unable to redirect descriptors for " + argv[0]);
+    }
+}
+
+void ProcessLauncher::newProcessGroup()
+{
+    posix_spawnattr_setpgroup(&attributes, 0);
+    flags |= POSIX_SPAWN_SETPGROUP;
+    posix_spawnattr_setflags(&attributes, flags);
+}
+
+pid_t ProcessLauncher::start() const
+{
+    pid_t pid;
+    int e = posix_spawn(&pid, args[0], &actions, &attributes, args.data(), environ);
+    if (e != 0)
+    {   throw std::system_error(e, std::generic_category(), "Unable to execute " + argv[0]);
+    }
+    return pid;
+}
+
+int ProcessLauncher::wait(pid_t pid)
+{
+    int status;
+    while (waitpid(pid, &status, 0) < 0)
+    {   if (errno != EINTR)
+        {   return -1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,210 @@
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+#include "metricset.h"
+#include "runtimeestimator.h"
+
+namespace
+{
+    const char* const featureMetrics[] = { "Size", "Sparseness", "SCC-Count" };
+    const size_t featureCount = 4; //the metrics, plus a constant
+    const size_t minSamples = 2 * featureCount; //fewer than this, and a model would mostly fit noise
+    const double timeOffset = 0.01; //seconds, so that instant runs still have a logarithm
+
+    std::string problemOf(const std::string& fullproblem)
+    {
+        return fullproblem.substr(0, fullproblem.find(':'));
+    }
+
+    //Reads the CPU time out of a .stat file, or returns a negative value if it doesn't tell it
+    double statTime(const fs::path& statFile, double timeLimit)
+    {
+        std::ifstream in(statFile);
+        double time = -1;
+        bool timeout = false, memout = false;
+        for (std::string line; std::getline(in, line);)
+        {   size_t eq = line.find('=');
+            if (eq == std::string::npos)
+            {   continue;
+            }
+            std::string key = line.substr(0, eq);
+            std::string val = line.substr(eq + 1);
+            try
+            {   if (key == "CPUTIME")
+                {   time = std::stod(val);
+                }
+            }
+            catch (std::exception& e)
+            {   return -1;
+            }
+            if (key == "TIMEOUT")
+            {   timeout = (val == "true");
+            }
+            else if (key == "MEMOUT")
+            {   memout = (val == "true");
+            }
+        }
+        if (memout) //it would have gone on for who knows how long
+        {   return -1;
+        }
+        if (timeout && time >= 0)
+        {   time = std::max(time, timeLimit);
+        }
+        return time;
+    }
+}
+
+RuntimeEstimator::RuntimeEstimator(const fs::path& storeDir, const std::string& solver, double timeLimit)
+    : scoresDir(storeDir / "graph-scores")
+{
+    //gather every previous run: <store>/benchmarks/<solver>/<run ID>/<hash>/<problem>.stat
+    std::map<std::pair<std::string, std::string>, std::pair<double, unsigned>> totals;
+    std::error_code ec;
+    fs::path solverDir = storeDir / "benchmarks" / solver;
+    for (const fs::directory_entry& runDir : fs::directory_iterator(solverDir, ec))
+    {   if (!runDir.is_directory(ec))
+        {   continue;
+        }
+        for (const fs::directory_entry& hashDir : fs::directory_iterator(runDir.path(), ec))
+        {   if (!hashDir.is_directory(ec))
+            {   continue;
+            }
+            for (const fs::directory_entry& statFile : fs::directory_iterator(hashDir.path(), ec))
+            {   if (statFile.path().extension() != ".stat")
+                {   continue;
+                }
+                double time = statTime(statFile.path(), timeLimit);
+                if (time >= 0)
+                {   std::pair<double, unsigned>& total = totals[{hashDir.path().filename().string(), statFile.path().stem().string()}];
+                    total.first += time;
+                    total.second++;
+                }
+            }
+        }
+    }
+
+    std::map<std::string, std::vector<std::pair<Features, double>>> samplesByProblem;
+    std::vector<std::pair<Features, double>> allSamples;
+    for (const auto& entry : totals)
+    {   double average = entry.second.first / entry.second.second;
+        history[entry.first] = average;
+        Features x;
+        if (features(entry.first.first, x))
+        {   std::pair<Features, double> sample { x, std::log(average + timeOffset) };
+            samplesByProblem[problemOf(entry.first.second)].push_back(sample);
+            allSamples.push_back(sample);
+        }
+    }
+    for (const auto& entry : samplesByProblem)
+    {   Model model = fit(entry.second);
+        if (!model.empty())
+        {   problemModels[entry.first] = model;
+        }
+    }
+    globalModel = fit(allSamples);
+}
+
+size_t RuntimeEstimator::historySize() const
+{
+    return history.size();
+}
+
+RuntimeEstimator::Estimate RuntimeEstimator::estimate(const std::string& hash, const std::string& fullproblem) const
+{
+    auto known = history.find({hash, fullproblem});
+    if (known != history.end())
+    {   return { HISTORY, known->second };
+    }
+
+    auto problemModel = problemModels.find(problemOf(fullproblem));
+    const Model& model = (problemModel != problemModels.end()? problemModel->second : globalModel);
+    Features x;
+    if (model.empty() || !features(hash, x))
+    {   return { NONE, 0 };
+    }
+    double logTime = 0;
+    for (size_t i = 0; i < featureCount; i++)
+    {   logTime += model[i] * x[i];
+    }
+    return { REGRESSION, std::max(0.0, std::exp(logTime) - timeOffset) };
+}
+
+bool RuntimeEstimator::features(const std::string& hash, Features& out) const
+{
+    auto cached = featureCache.find(hash);
+    if (cached == featureCache.end())
+    {   std::pair<bool, Features> entry { false, {} };
+        try
+        {   MetricSet scores(scoresDir / hash);
+            entry.first = std::all_of(std::begin(featureMetrics), std::end(featureMetrics), [&scores](const char* m) { return scores.exists(m); });
+            if (entry.first)
+            {   entry.second = { 1, std::log1p(std::max(0.0, scores.getScore("Size"))), scores.getScore("Sparseness"),
+                    std::log1p(std::max(0.0, scores.getScore("SCC-Count"))) };
+                entry.first = std::all_of(entry.second.begin(), entry.second.end(), [](double v) { return std::isfinite(v); });
+            }
+        }
+        catch (std::exception& e)
+        { }
+        cached = featureCache.emplace(hash, entry).first;
+    }
+    out = cached->second.second;
+    return cached->second.first;
+}
+
+//Least squares, with a touch of ridge regularisation so that features that don't vary in the history
+//(e.g. every graph having one SCC) don't make the system singular
+RuntimeEstimator::Model RuntimeEstimator::fit(const std::vector<std::pair<Features, double>>& samples)
+{
+    if (samples.size() < minSamples)
+    {   return {};
+    }
+
+    //normal equations, as an augmented matrix [X'X + lambda*I | X'y]
+    std::vector<std::vector<double>> a(featureCount, std::vector<double>(featureCount + 1, 0));
+    for (const auto& sample : samples)
+    {   for (size_t i = 0; i < featureCount; i++)
+        {   for (size_t j = 0; j < featureCount; j++)
+            {   a[i][j] += sample.first[i] * sample.first[j];
+            }
+            a[i][featureCount] += sample.first[i] * sample.second;
+        }
+    }
+    double trace = 0;
+    for (size_t i = 0; i < featureCount; i++)
+    {   trace += a[i][i];
+    }
+    for (size_t i = 0; i < featureCount; i++)
+    {   a[i][i] += 1e-6 * trace / featureCount;
+    }
+
+    //Gaussian elimination with partial pivoting
+    for (size_t col = 0; col < featureCount; col++)
+    {   size_t pivot = col;
+        for (size_t row = col + 1; row < featureCount; row++)
+        {   if (std::abs(a[row][col]) > std::abs(a[pivot][col]))
+            {   pivot = row;
+            }
+        }
+        if (std::abs(a[pivot][col]) < 1e-12)
+        {   return {};
+        }
+        std::swap(a[col], a[pivot]);
+        for (size_t row = 0; row < featureCount; row++)
+        {   if (row != col)
+            {   double factor = a[row][col] / a[col][col];
+                for (size_t k = col; k <= featureCount; k++)
+                {   a[row][k] -= factor * a[col][k];
+                }
+            }
+        }
+    }
+
+    Model model(featureCount);
+    for (size_t i = 0; i < featureCount; i++)
+    {   model[i] = a[i][featureCount] / a[i][i];
+        if (!std::isfinite(model[i]))
+        {   return {};
+        }
+    }
+    return model;
+}
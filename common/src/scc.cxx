@@ -0,0 +1,89 @@
+#include <algorithm>
+#include "scc.h"
+
+SCCDecomposition::SCCDecomposition(const Graph& graph) : component(graph.argCount(), -1)
+{
+    struct Frame
+    {
+        int32_t arg;
+        uint32_t nextEdge;
+    };
+
+    int32_t argCount = graph.argCount();
+    std::vector<int32_t> index(argCount, -1);
+    std::vector<int32_t> lowlink(argCount, 0);
+    std::vector<bool> onStack(argCount, false);
+    std::vector<int32_t> stack;
+    std::vector<Frame> callStack;
+    int32_t nextIndex = 0;
+
+    auto visit = [&](int32_t arg)
+    {
+        index[arg] = lowlink[arg] = nextIndex++;
+        stack.push_back(arg);
+        onStack[arg] = true;
+        callStack.push_back({ arg, 0 });
+    };
+
+    for (int32_t root = 0; root < argCount; root++)
+    {   if (index[root] != -1)
+        {   continue;
+        }
+        visit(root);
+        while (!callStack.empty())
+        {   Frame& frame = callStack.back();
+            int32_t arg = frame.arg;
+            ArgRange targets = graph.attacksFrom(arg);
+            if (frame.nextEdge < targets.size())
+            {   int32_t target = targets.begin()[frame.nextEdge++];
+                if (index[target] == -1)
+                {   visit(target); //invalidates frame
+                }
+                else if (onStack[target])
+                {   lowlink[arg] = std::min(lowlink[arg], index[target]);
+                }
+                continue;
+            }
+
+            //all successors done: arg is either the root of a component, or passes its lowlink up
+            if (lowlink[arg] == index[arg])
+            {   int32_t id = componentSizes.size();
+                int32_t size = 0;
+                int32_t member;
+                do
+                {   member = stack.back();
+                    stack.pop_back();
+                    onStack[member] = false;
+                    component[member] = id;
+                    size++;
+                } while (member != arg);
+                componentSizes.push_back(size);
+            }
+            callStack.pop_back();
+            if (!callStack.empty())
+            {   int32_t parent = callStack.back().arg;
+                lowlink[parent] = std::min(lowlink[parent], lowlink[arg]);
+            }
+        }
+    }
+}
+
+int32_t SCCDecomposition::count() const
+{
+    return componentSizes.size();
+}
+
+int32_t SCCDecomposition::componentOf(int32_t arg) const
+{
+    return component[arg];
+}
+
+const std::vector<int32_t>& SCCDecomposition::components() const
+{
+    return component;
+}
+
+const std::vector<int32_t>& SCCDecomposition::sizes() const
+{
+    return componentSizes;
+}
@@ -0,0 +1,299 @@
+#include <cctype>
+#include <algorithm>
+#include <stdexcept>
+#include "semanticverifier.h"
+#include "compressedfile.h"
+
+namespace
+{
+    const std::string_view separators(" ,:\n\r\t"); //as between the arguments of an extension elsewhere
+
+    enum Mark : uint8_t { MEMBER = 1, DEFEATED = 2 }; //DEFEATED: attacked by a member
+
+    //Splits e.g. "DC-CO" into "DC" and the semantics; false if the problem isn't one that can be verified
+    bool parseProblem(const std::string& problem, std::string& task, SemanticVerifier::Semantics& semantics)
+    {
+        size_t dash = problem.find('-');
+        if (dash == std::string::npos)
+        {   return false;
+        }
+        task = problem.substr(0, dash);
+        std::string name = problem.substr(dash + 1);
+        if (task != "EE" && task != "SE" && task != "DC" && task != "DS")
+        {   return false;
+        }
+        if (name == "AD")
+        {   semantics = SemanticVerifier::ADMISSIBLE;
+        }
+        else if (name == "CO")
+        {   semantics = SemanticVerifier::COMPLETE;
+        }
+        else if (name == "ST")
+        {   semantics = SemanticVerifier::STABLE;
+        }
+        else if (name == "GR")
+        {   semantics = SemanticVerifier::GROUNDED;
+        }
+        else
+        {   return false;
+        }
+        return true;
+    }
+}
+
+bool SemanticVerifier::supports(const std::string& problem)
+{
+    std::string task;
+    Semantics semantics;
+    return parseProblem(problem, task, semantics);
+}
+
+SemanticVerifier::SemanticVerifier(const Graph& graph) : graph(graph)
+{
+    ids.reserve(graph.argCount());
+    for (int32_t arg = 0; arg < graph.argCount(); arg++)
+    {   ids.emplace(graph.argName(arg), arg);
+    }
+}
+
+//Extensions of an enumeration are the bracketed lists one level in, e.g. [a1,a2] in [[a1,a2],[a3]], whereas
+//a single extension is the outermost one; anything after the closing bracket is ignored
+SemanticVerifier::Result SemanticVerifier::verify(const fs::path& output, const std::string& problem, const std::string& argument) const
+{
+    Check check(*this, problem, argument, output);
+    readChunks(output, [&check](std::string_view chunk) { check.feed(chunk); });
+    return check.finish();
+}
+
+SemanticVerifier::Check::Check(const SemanticVerifier& verifier, const std::string& problem, const std::string& argument, const fs::path& source)
+    : verifier(verifier), source(source)
+{
+    if (!parseProblem(problem, task, semantics))
+    {   throw std::runtime_error("Problem " + problem + " can't be verified");
+    }
+    if (task == "DC" || task == "DS")
+    {   auto known = verifier.ids.find(argument);
+        if (known == verifier.ids.end())
+        {   throw std::runtime_error("Argument " + argument + " isn't in the graph");
+        }
+        argId = known->second;
+    }
+    extensionDepth = (task == "EE"? 2 : 1);
+}
+
+//The first word (after any whitespace) is only read as far as it takes to tell whether it's YES or NO
+void SemanticVerifier::Check::feed(std::string_view chunk)
+{
+    size_t i = 0;
+    if (phase == WORD)
+    {   for (; i < chunk.size(); i++)
+        {   unsigned char c = chunk[i];
+            if (word.empty() && std::isspace(c))
+            {   continue;
+            }
+            if (!std::isalpha(c) || word.size() == 4)
+            {   break;
+            }
+            if (word.empty())
+            {   wordOffset = offset + i;
+            }
+            word += c;
+        }
+        if (i < chunk.size())
+        {   decide();
+        }
+    }
+    if (phase == SCAN)
+    {   scan(chunk, i);
+    }
+    offset += chunk.size();
+}
+
+//Only the witness after YES (DC) or NO (DS) is checked; an enumeration is read from the start, so any word
+//there is an argument outside an extension
+void SemanticVerifier::Check::decide()
+{
+    if ((task == "DC" && word != "YES") || (task == "DS" && word != "NO"))
+    {   phase = DONE; //nothing to witness
+    }
+    else if (task == "SE" && word == "NO")
+    {   phase = DONE; //no extension, which only a reference can confirm
+    }
+    else if ((task == "EE" || task == "SE") && !word.empty())
+    {   throw std::runtime_error("Invalid output " + source.string() + ": argument outside an extension at offset " + std::to_string(wordOffset));
+    }
+    else
+    {   phase = SCAN;
+    }
+}
+
+void SemanticVerifier::Check::scan(std::string_view chunk, size_t i)
+{
+    auto nameEnd = [&chunk](size_t from)
+    {   while (from < chunk.size() && chunk[from] != '[' && chunk[from] != ']' && separators.find(chunk[from]) == std::string_view::npos)
+        {   from++;
+        }
+        return from;
+    };
+    if (!name.empty())
+    {   size_t end = nameEnd(i);
+        name.append(chunk.substr(i, end - i));
+        if (end == chunk.size())
+        {   return;
+        }
+        addName(name);
+        name.clear();
+        i = end;
+    }
+    for (; i < chunk.size(); i++)
+    {   char c = chunk[i];
+        if (c == '[')
+        {   if (++depth > extensionDepth)
+            {   throw std::runtime_error("Invalid output " + source.string() + ": too many nested brackets");
+            }
+            members.clear();
+            unknown = false;
+        }
+        else if (c == ']')
+        {   if (depth == extensionDepth)
+            {   endExtension();
+            }
+            if (--depth <= 0)
+            {   phase = DONE;
+                return;
+            }
+        }
+        else if (separators.find(c) == std::string_view::npos)
+        {   if (depth != extensionDepth)
+            {   throw std::runtime_error("Invalid output " + source.string() + ": argument outside an extension at offset " + std::to_string(offset + i));
+            }
+            size_t end = nameEnd(i);
+            if (end == chunk.size())
+            {   name.assign(chunk.substr(i));
+                return;
+            }
+            addName(chunk.substr(i, end - i));
+            i = end - 1;
+        }
+    }
+}
+
+void SemanticVerifier::Check::addName(std::string_view argName)
+{
+    auto known = verifier.ids.find(argName);
+    if (known == verifier.ids.end())
+    {   unknown = true;
+    }
+    else
+    {   members.push_back(known->second);
+    }
+}
+
+void SemanticVerifier::Check::endExtension()
+{
+    bool valid = !unknown && verifier.isExtension(members, semantics);
+    if (valid && argId >= 0)
+    {   bool contains = std::find(members.begin(), members.end(), argId) != members.end();
+        valid = (task == "DC"? contains : !contains);
+    }
+    if (valid)
+    {   result.valid++;
+    }
+    else
+    {   result.invalid++;
+        if (result.invalidIndices.size() < maxReportedInvalid)
+        {   result.invalidIndices.push_back(index);
+        }
+    }
+    index++;
+}
+
+SemanticVerifier::Result SemanticVerifier::Check::finish()
+{
+    if (phase == WORD)
+    {   decide();
+    }
+    if (phase == SCAN && !name.empty())
+    {   addName(name);
+        name.clear();
+    }
+    if (phase == SCAN && depth > 0)
+    {   throw std::runtime_error("Invalid output " + source.string() + ": missing ']'");
+    }
+    return result;
+}
+
+//Members are marked first, then everything they attack; every check then only looks at marks. Only marks
+//that were set are cleared again, so that admissibility costs no more than the members' attacks.
+bool SemanticVerifier::isExtension(const std::vector<int32_t>& members, Semantics semantics) const
+{
+    thread_local std::vector<uint8_t> marks;
+    marks.resize(std::max<size_t>(marks.size(), graph.argCount()), 0);
+    auto clear = [&]()
+    {   for (int32_t member : members)
+        {   marks[member] = 0;
+            for (int32_t target : graph.attacksFrom(member))
+            {   marks[target] = 0;
+            }
+        }
+    };
+
+    if (semantics == GROUNDED)
+    {   if (!grounded)
+        {   grounded = std::make_unique<GroundedLabelling>(graph);
+        }
+        int32_t distinct = 0;
+        bool ok = true;
+        for (int32_t member : members)
+        {   if (!marks[member])
+            {   marks[member] = MEMBER;
+                distinct++;
+                ok = ok && grounded->label(member) == GroundedLabelling::IN;
+            }
+        }
+        for (int32_t member : members)
+        {   marks[member] = 0;
+        }
+        return ok && distinct == grounded->inCount();
+    }
+
+    for (int32_t member : members)
+    {   marks[member] = MEMBER;
+    }
+    bool ok = true;
+    for (size_t i = 0; i < members.size() && ok; i++)
+    {   for (int32_t target : graph.attacksFrom(members[i]))
+        {   if (marks[target] & MEMBER)
+            {   ok = false; //not conflict-free
+                break;
+            }
+            marks[target] |= DEFEATED;
+        }
+    }
+
+    if (ok && semantics == STABLE)
+    {   for (int32_t arg = 0; arg < graph.argCount() && ok; arg++)
+        {   ok = (marks[arg] != 0);
+        }
+    }
+    else if (ok)
+    {   for (size_t i = 0; i < members.size() && ok; i++)
+        {   for (int32_t attacker : graph.attackersOf(members[i]))
+            {   if (!(marks[attacker] & DEFEATED))
+                {   ok = false; //not defended
+                    break;
+                }
+            }
+        }
+        //complete: whatever it defends must be in it
+        for (int32_t arg = 0; arg < graph.argCount() && ok && semantics == COMPLETE; arg++)
+        {   if (marks[arg] & MEMBER)
+            {   continue;
+            }
+            ArgRange attackers = graph.attackersOf(arg);
+            ok = std::any_of(attackers.begin(), attackers.end(), [](int32_t attacker) { return !(marks[attacker] & DEFEATED); });
+        }
+    }
+    clear();
+    return ok;
+}
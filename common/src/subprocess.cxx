@@ -0,0 +1,256 @@
+#include <system_error>
+#include <mutex>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <dirent.h>
+#include "subprocess.h"
+#include "processlauncher.h"
+
+namespace
+{
+    const int monitorTickMs = 100;
+
+    struct GroupUsage
+    {
+        double cpuSeconds = 0;
+        size_t residentBytes = 0;
+    };
+
+    //Sums the usage of every live process in the group. A process's stat includes the CPU time of the
+    //children it has already reaped, so finished helper processes are still counted.
+    GroupUsage groupUsage(pid_t group)
+    {
+        static const double ticksPerSecond = sysconf(_SC_CLK_TCK);
+        static const size_t pageSize = sysconf(_SC_PAGESIZE);
+        GroupUsage usage;
+        DIR* proc = opendir("/proc");
+        if (!proc)
+        {   return usage;
+        }
+        while (dirent* entry = readdir(proc))
+        {   if (entry->d_name[0] < '0' || entry->d_name[0] > '9')
+            {   continue;
+            }
+            std::ifstream statFile(std::string("/proc/") + entry->d_name + "/stat");
+            std::string stat;
+            if (!std::getline(statFile, stat))
+            {   continue; //exited in the meantime
+            }
+            size_t commEnd = stat.rfind(')'); //the command name may contain spaces
+            if (commEnd == std::string::npos)
+            {   continue;
+            }
+            std::istringstream fields(stat.substr(commEnd + 2));
+            std::string state;
+            long ppid, pgrp, session, tty, tpgid;
+            unsigned long flags, minflt, cminflt, majflt, cmajflt, utime, stime;
+            long cutime, cstime, priority, nice, threads, itrealvalue;
+            unsigned long long starttime;
+            unsigned long vsize;
+            long rss;
+            fields >> state >> ppid >> pgrp >> session >> tty >> tpgid >> flags >> minflt >> cminflt >> majflt >> cmajflt
+                >> utime >> stime >> cutime >> cstime >> priority >> nice >> threads >> itrealvalue >> starttime >> vsize >> rss;
+            if (!fields || pgrp != group)
+            {   continue;
+            }
+            usage.cpuSeconds += (utime + stime + cutime + cstime) / ticksPerSecond;
+            usage.residentBytes += rss * pageSize;
+        }
+        closedir(proc);
+        return usage;
+    }
+
+    void closeFd(int& fd)
+    {
+        if (fd >= 0)
+        {   close(fd);
+            fd = -1;
+        }
+    }
+}
+
+Subprocess::Subprocess(const std::vector<std::string>& argv, ResourceLimits limits) : limits(limits)
+{
+    static std::once_flag sigpipeFlag;
+    std::call_once(sigpipeFlag, []() { signal(SIGPIPE, SIG_IGN); });
+
+    int in[2], out[2];
+    if (pipe2(in, O_CLOEXEC) < 0)
+    {   throw std::system_error(errno, std::generic_category(), "Unable to create pipe for " + argv[0]);
+    }
+    if (pipe2(out, O_CLOEXEC) < 0)
+    {   int e = errno;
+        close(in[0]); close(in[1]);
+        throw std::system_error(e, std::generic_category(), "Unable to create pipe for " + argv[0]);
+    }
+
+    try
+    {   ProcessLauncher launcher(argv);
+        //the duplicates lose close-on-exec, so only these two survive the exec
+        launcher.redirect(STDIN_FILENO, in[0]);
+        launcher.redirect(STDOUT_FILENO, out[1]);
+        launcher.newProcessGroup(); //so the limits can be enforced on (and a kill reaches) everything it starts
+        child = launcher.start();
+    }
+    catch (...)
+    {   close(in[0]); close(in[1]); close(out[0]); close(out[1]);
+        throw;
+    }
+    close(in[0]);
+    close(out[1]);
+    inFd = in[1];
+    outFd = out[0];
+    startClock();
+}
+
+Subprocess::~Subprocess()
+{
+    wait();
+}
+
+pid_t Subprocess::pid() const
+{
+    return child;
+}
+
+bool Subprocess::writeLine(const std::string& line)
+{
+    std::string data = line + '\n';
+    for (size_t done = 0; done < data.size();)
+    {   ssize_t written = write(inFd, data.data() + done, data.size() - done);
+        if (written < 0)
+        {   if (errno == EINTR) continue;
+            return false;
+        }
+        done += written;
+    }
+    return true;
+}
+
+bool Subprocess::readLine(std::string& line)
+{
+    char chunk[4096];
+    for (;;)
+    {   size_t newline = readBuffer.find('\n');
+        if (newline != std::string::npos)
+        {   line = readBuffer.substr(0, newline);
+            readBuffer.erase(0, newline + 1);
+            return true;
+        }
+        if (!awaitOutput())
+        {   return false;
+        }
+        ssize_t got = read(outFd, chunk, sizeof(chunk));
+        if (got < 0 && errno == EINTR)
+        {   continue;
+        }
+        if (got <= 0)
+        {   return false;
+        }
+        readBuffer.append(chunk, got);
+    }
+}
+
+bool Subprocess::readToEnd(std::string& out)
+{
+    char chunk[4096];
+    out.swap(readBuffer);
+    readBuffer.clear();
+    for (;;)
+    {   if (!awaitOutput())
+        {   return false;
+        }
+        ssize_t got = read(outFd, chunk, sizeof(chunk));
+        if (got < 0 && errno == EINTR)
+        {   continue;
+        }
+        if (got <= 0)
+        {   return true;
+        }
+        out.append(chunk, got);
+    }
+}
+
+bool Subprocess::awaitOutput()
+{
+    if (!limits.any())
+    {   return true; //just block in read()
+    }
+    if (hit != NONE)
+    {   return false;
+    }
+
+    pollfd pfd { outFd, POLLIN, 0 };
+    for (;;)
+    {   int timeout = monitorTickMs;
+        if (limits.wallSeconds > 0)
+        {   double remaining = limits.wallSeconds - elapsed();
+            timeout = std::max(0, std::min(timeout, (int)(remaining * 1000) + 1));
+        }
+        int ready = poll(&pfd, 1, timeout);
+        if (ready > 0)
+        {   return true;
+        }
+        if (ready < 0 && errno != EINTR)
+        {   return true; //let read() report the problem
+        }
+
+        if (limits.wallSeconds > 0 && elapsed() >= limits.wallSeconds)
+        {   hit = WALL_TIME;
+        }
+        else if (limits.cpuSeconds > 0 || limits.memoryMB > 0)
+        {   GroupUsage usage = groupUsage(child);
+            if (limits.cpuSeconds > 0 && usage.cpuSeconds - cpuStart >= limits.cpuSeconds)
+            {   hit = CPU_TIME;
+            }
+            else if (limits.memoryMB > 0 && usage.residentBytes >= limits.memoryMB * 1024 * 1024)
+            {   hit = MEMORY;
+            }
+        }
+        if (hit != NONE)
+        {   kill(-child, SIGKILL);
+            return false;
+        }
+    }
+}
+
+void Subprocess::startClock()
+{
+    clockStart = std::chrono::steady_clock::now();
+    if (limits.cpuSeconds > 0)
+    {   cpuStart = groupUsage(child).cpuSeconds;
+    }
+}
+
+double Subprocess::elapsed() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - clockStart).count();
+}
+
+Subprocess::LimitHit Subprocess::limitHit() const
+{
+    return hit;
+}
+
+void Subprocess::closeInput()
+{
+    closeFd(inFd);
+}
+
+int Subprocess::wait()
+{
+    closeFd(inFd);
+    closeFd(outFd);
+    if (!reaped && child > 0)
+    {   status = ProcessLauncher::wait(child);
+        reaped = true;
+    }
+    return status;
+}
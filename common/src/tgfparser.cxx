@@ -0,0 +1,305 @@
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <memory>
+#include <cstring>
+#include "tgfparser.h"
+#include "SpookyV2.h"
+#include "tokenizer.h"
+
+namespace
+{
+    constexpr uint64_t seed1 = 1;
+    constexpr uint64_t seed2 = 2;
+
+    //Sorts like the name itself whenever the keys differ: names shorter than 8 bytes are padded with zeros,
+    //which only ties them with names they share all their bytes with
+    uint64_t prefixKey(std::string_view name)
+    {
+        uint64_t key = 0;
+        for (size_t i = 0; i < 8; i++)
+        {   key = key << 8 | (i < name.size()? (unsigned char)name[i] : 0);
+        }
+        return key;
+    }
+
+    //LSD radix sort of keys using only their low keyBits bits
+    void radixSort(std::vector<uint64_t>& keys, int keyBits)
+    {
+        constexpr int digitBits = 11;
+        constexpr size_t buckets = size_t(1) << digitBits;
+        if (keys.size() < 256) //not worth setting up the buckets
+        {   std::sort(keys.begin(), keys.end());
+            return;
+        }
+        std::vector<uint64_t> scratch(keys.size());
+        for (int shift = 0; shift < keyBits; shift += digitBits)
+        {   size_t counts[buckets] = {};
+            for (uint64_t k : keys)
+            {   counts[(k >> shift) & (buckets - 1)]++;
+            }
+            size_t total = 0;
+            for (size_t& c : counts)
+            {   size_t n = c;
+                c = total;
+                total += n;
+            }
+            for (uint64_t k : keys)
+            {   scratch[counts[(k >> shift) & (buckets - 1)]++] = k;
+            }
+            keys.swap(scratch);
+        }
+    }
+
+    //Open addressing table mapping names to dense ids in order of first appearance. Each slot holds the
+    //top half of the name's hash next to its id + 1 (0 for empty), so a probe only has to look at the
+    //name itself, which stays in the scanned buffer, once the hashes match.
+    class NameTable
+    {
+        public:
+            NameTable() : slots(1024, 0), mask(1023) {
+            }
+
+            static uint64_t hashOf(std::string_view name)
+            {
+                return SpookyHash::Hash64(name.data(), name.size(), seed1);
+            }
+
+            void prefetch(uint64_t h) const
+            {
+                __builtin_prefetch(&slots[h & mask]);
+            }
+
+            uint32_t intern(std::string_view name, uint64_t h, bool& inserted)
+            {
+                uint64_t tag = h & tagMask;
+                for (size_t slot = h & mask;; slot = (slot + 1) & mask)
+                {   uint64_t entry = slots[slot];
+                    if (entry == 0)
+                    {   names.push_back(name);
+                        slots[slot] = tag | names.size();
+                        inserted = true;
+                        if (names.size() * 2 > slots.size())
+                        {   grow();
+                        }
+                        return names.size() - 1;
+                    }
+                    uint32_t id = (entry & ~tagMask) - 1;
+                    if ((entry & tagMask) == tag && names[id] == name)
+                    {   inserted = false;
+                        return id;
+                    }
+                }
+            }
+
+            std::vector<std::string_view> names;
+        private:
+            void grow()
+            {
+                std::vector<uint64_t> old(slots.size() * 2, 0);
+                old.swap(slots);
+                mask = slots.size() - 1;
+                for (uint64_t entry : old)
+                {   if (entry == 0)
+                    {   continue;
+                    }
+                    //the slot only keeps the top half of the hash, so the name has to be hashed again
+                    size_t slot = hashOf(names[(entry & ~tagMask) - 1]) & mask;
+                    while (slots[slot] != 0)
+                    {   slot = (slot + 1) & mask;
+                    }
+                    slots[slot] = entry;
+                }
+            }
+
+            static constexpr uint64_t tagMask = 0xffffffff00000000ull;
+            std::vector<uint64_t> slots;
+            size_t mask;
+    };
+
+    //Batches small updates so SpookyHash sees large blocks. Spooky is incremental, so the result
+    //is the same as hashing the concatenation of everything fed in.
+    class BlockHasher
+    {
+        public:
+            BlockHasher() : buffer(new char[blockSize])
+            {
+                hash.Init(seed1, seed2);
+            }
+
+            void feed(std::string_view data)
+            {
+                if (used + data.size() > blockSize)
+                {   flush();
+                    if (data.size() > blockSize)
+                    {   hash.Update(data.data(), data.size());
+                        return;
+                    }
+                }
+                std::memcpy(buffer.get() + used, data.data(), data.size());
+                used += data.size();
+            }
+
+            std::string digest()
+            {
+                flush();
+                uint64_t hash1;
+                uint64_t hash2;
+                hash.Final(&hash1, &hash2);
+                std::stringstream streamtmp;
+                streamtmp << std::hex << hash1 << hash2;
+                return streamtmp.str();
+            }
+        private:
+            void flush()
+            {
+                if (used > 0)
+                {   hash.Update(buffer.get(), used);
+                    used = 0;
+                }
+            }
+
+            static constexpr size_t blockSize = 1 << 16;
+            SpookyHash hash;
+            std::unique_ptr<char[]> buffer;
+            size_t used = 0;
+    };
+}
+
+bool scanTgf(std::string_view data, const std::string& path, TgfContents& out)
+{
+    TokenStream tokens(data, whitespaceDelimiters);
+    auto nextTok = [&tokens](std::string_view& tok)
+    {
+        tok = tokens.next();
+        return !tok.empty();
+    };
+    //only needed for warnings, so computed on demand; they come in file order, so each count carries on from the last
+    const char* countedTo = data.data();
+    size_t line = 1;
+    auto lineOf = [&countedTo, &line](std::string_view tok)
+    {
+        line += std::count(countedTo, tok.data(), '\n');
+        countedTo = tok.data();
+        return line;
+    };
+
+    NameTable table;
+    std::vector<bool> declared;
+    std::vector<uint64_t> edges;
+    std::string_view tok;
+    bool inserted;
+
+    while (nextTok(tok) && tok != "#")
+    {   table.intern(tok, NameTable::hashOf(tok), inserted);
+        if (!inserted)
+        {   std::cerr << "WARNING: Malformed tgf file " << path << ": duplicate argument on line " << lineOf(tok) << ". Ignoring." << std::endl;
+        }
+    }
+    declared.assign(table.names.size(), true);
+
+    //the table is far bigger than the cache for large graphs, so attacks are interned in batches: hashing
+    //every name in the batch and prefetching its slot first lets the cache misses overlap
+    constexpr size_t batchSize = 32; //names, i.e. 16 attacks
+    std::string_view batch[batchSize];
+    uint64_t batchHashes[batchSize];
+    for (;;)
+    {   size_t count = 0;
+        while (count < batchSize && nextTok(batch[count]))
+        {   batchHashes[count] = NameTable::hashOf(batch[count]);
+            table.prefetch(batchHashes[count]);
+            count++;
+        }
+        if (count % 2 != 0)
+        {   std::cerr << "ERROR: Malformed tgf file " << path << ": an attack is missing its destination" << std::endl;
+            return false;
+        }
+        for (size_t i = 0; i < count; i += 2)
+        {   uint64_t src = table.intern(batch[i], batchHashes[i], inserted);
+            uint64_t dest = table.intern(batch[i + 1], batchHashes[i + 1], inserted);
+            edges.push_back(src << 32 | dest);
+        }
+        if (count < batchSize)
+        {   break;
+        }
+    }
+    declared.resize(table.names.size(), false);
+
+    //canonical order: names sorted, attacks sorted by (source name, target name)
+    //names are sorted by their first 8 bytes packed into an integer (big endian, so integer order is byte order),
+    //only comparing the whole strings when those tie; this keeps the sort mostly out of the name data
+    std::vector<std::pair<uint64_t, uint32_t>> keys(table.names.size());
+    for (uint32_t id = 0; id < keys.size(); id++)
+    {   keys[id] = { prefixKey(table.names[id]), id };
+    }
+    std::sort(keys.begin(), keys.end(), [&table](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b)
+        {
+            return a.first != b.first? a.first < b.first : table.names[a.second] < table.names[b.second];
+        });
+    std::vector<uint32_t> order(keys.size());
+    for (uint32_t r = 0; r < keys.size(); r++)
+    {   order[r] = keys[r].second;
+    }
+    std::vector<std::pair<uint64_t, uint32_t>>().swap(keys);
+    std::vector<uint32_t> rank(order.size());
+    out.names.resize(order.size());
+    out.declared.resize(order.size());
+    for (uint32_t r = 0; r < order.size(); r++)
+    {   rank[order[r]] = r;
+        out.names[r] = table.names[order[r]];
+        out.declared[r] = declared[order[r]];
+    }
+
+    //ranks only need as many bits as it takes to count the names, so packing the two closer together
+    //leaves fewer bits for the radix sort to go through
+    int rankBits = 1;
+    while (rankBits < 32 && (uint64_t(1) << rankBits) < rank.size())
+    {   rankBits++;
+    }
+    for (uint64_t& e : edges)
+    {   e = (uint64_t)rank[e >> 32] << rankBits | rank[e & 0xffffffff];
+    }
+    radixSort(edges, 2 * rankBits);
+    uint64_t lowMask = (uint64_t(1) << rankBits) - 1;
+    for (uint64_t& e : edges)
+    {   e = (e >> rankBits) << 32 | (e & lowMask);
+    }
+    out.attacks.clear();
+    out.attacks.reserve(edges.size());
+    for (uint64_t e : edges)
+    {   if (!out.attacks.empty() && out.attacks.back() == e)
+        {   std::cerr << "WARNING: Malformed tgf file " << path << ": duplicate attack " << out.names[e >> 32] << " " << out.names[e & 0xffffffff] << ". Ignoring." << std::endl;
+            continue;
+        }
+        out.attacks.push_back(e);
+    }
+    return true;
+}
+
+std::string tgfHash(const TgfContents& contents)
+{
+    //the names are scattered through the scanned buffer; copied together (in sorted order), every
+    //attack's source is read in sequence and its target from a far smaller, mostly cached, table
+    std::string packed;
+    std::vector<size_t> offsets(contents.names.size() + 1, 0);
+    for (size_t i = 0; i < contents.names.size(); i++)
+    {   offsets[i + 1] = offsets[i] + contents.names[i].size();
+    }
+    packed.reserve(offsets.back());
+    for (std::string_view name : contents.names)
+    {   packed.append(name);
+    }
+    auto name = [&packed, &offsets](size_t i) { return std::string_view(packed.data() + offsets[i], offsets[i + 1] - offsets[i]); };
+
+    BlockHasher hasher;
+    for (size_t i = 0; i < contents.names.size(); i++)
+    {   if (contents.declared[i])
+        {   hasher.feed(name(i));
+        }
+    }
+    for (uint64_t att : contents.attacks)
+    {   hasher.feed(name(att >> 32));
+        hasher.feed(name(att & 0xffffffff));
+    }
+    return hasher.digest();
+}
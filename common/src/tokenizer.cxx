@@ -0,0 +1,132 @@
+#include <stdexcept>
+#include "tokenizer.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define TOKENIZER_X86
+    #include <immintrin.h>
+#endif
+
+const DelimiterSet whitespaceDelimiters(" \n\t\r\v\f");
+
+DelimiterSet::DelimiterSet(std::string_view delimiters)
+{
+    for (char c : delimiters)
+    {   if (table[(unsigned char)c])
+        {   continue;
+        }
+        if (memberCount == maxChars)
+        {   throw std::length_error("Too many delimiter characters");
+        }
+        table[(unsigned char)c] = true;
+        members[memberCount++] = c;
+    }
+}
+
+namespace
+{
+    //Each kernel classifies exactly 64 bytes
+    uint64_t classifyScalar(const char* p, const DelimiterSet& delims)
+    {
+        uint64_t mask = 0;
+        for (unsigned i = 0; i < 64; i++)
+        {   mask |= (uint64_t)delims.contains(p[i]) << i;
+        }
+        return mask;
+    }
+
+#ifdef TOKENIZER_X86
+    uint64_t classifySSE2(const char* p, const DelimiterSet& delims)
+    {
+        uint64_t mask = 0;
+        for (unsigned part = 0; part < 4; part++)
+        {   __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * part));
+            __m128i hits = _mm_setzero_si128();
+            for (size_t i = 0; i < delims.count(); i++)
+            {   hits = _mm_or_si128(hits, _mm_cmpeq_epi8(block, _mm_set1_epi8(delims.chars()[i])));
+            }
+            mask |= (uint64_t)(unsigned)_mm_movemask_epi8(hits) << (16 * part);
+        }
+        return mask;
+    }
+
+    __attribute__((target("avx2")))
+    uint64_t classifyAVX2(const char* p, const DelimiterSet& delims)
+    {
+        __m256i lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hi = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+        __m256i hitsLo = _mm256_setzero_si256();
+        __m256i hitsHi = _mm256_setzero_si256();
+        for (size_t i = 0; i < delims.count(); i++)
+        {   __m256i needle = _mm256_set1_epi8(delims.chars()[i]);
+            hitsLo = _mm256_or_si256(hitsLo, _mm256_cmpeq_epi8(lo, needle));
+            hitsHi = _mm256_or_si256(hitsHi, _mm256_cmpeq_epi8(hi, needle));
+        }
+        return (uint64_t)(unsigned)_mm256_movemask_epi8(hitsLo) | (uint64_t)(unsigned)_mm256_movemask_epi8(hitsHi) << 32;
+    }
+#endif
+
+    typedef uint64_t (*ClassifyKernel)(const char*, const DelimiterSet&);
+
+    ClassifyKernel selectKernel()
+    {
+#ifdef TOKENIZER_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {   return classifyAVX2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {   return classifySSE2;
+        }
+#endif
+        return classifyScalar;
+    }
+
+    const ClassifyKernel classify = selectKernel();
+}
+
+TokenStream::TokenStream(std::string_view data, const DelimiterSet& delims) : block(data.data()), end(data.data() + data.size()), delims(delims)
+{
+    load();
+}
+
+void TokenStream::load()
+{
+    if (end - block >= 64)
+    {   delimMask = classify(block, delims);
+        return;
+    }
+    //partial last block: never read past the end, and treat the missing bytes as delimiters
+    delimMask = ~0ULL;
+    for (unsigned i = 0; block + i < end; i++)
+    {   if (!delims.contains(block[i]))
+        {   delimMask &= ~(1ULL << i);
+        }
+    }
+}
+
+std::string_view TokenStream::next()
+{
+    while (delimMask == ~0ULL)
+    {   if (end - block <= 64)
+        {   return std::string_view();
+        }
+        block += 64;
+        load();
+    }
+    unsigned startBit = __builtin_ctzll(~delimMask);
+    const char* start = block + startBit;
+
+    uint64_t following = delimMask & (~0ULL << startBit);
+    while (following == 0) //the token runs on into the next block
+    {   if (end - block <= 64)
+        {   delimMask = ~0ULL;
+            return std::string_view(start, end - start);
+        }
+        block += 64;
+        load();
+        following = delimMask;
+    }
+    unsigned endBit = __builtin_ctzll(following);
+    delimMask |= (1ULL << endBit) - 1; //mark the token as consumed
+    return std::string_view(start, block + endBit - start);
+}
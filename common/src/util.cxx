@@ -7,16 +7,18 @@
 #include <algorithm>
 #include <filesystem>
 #include <random>
+#include <system_error>
 #include "graph.h"
 #include "util.h"
-#include "SpookyV2.h"
 #include "opts.h"
+#include "mappedfile.h"
+#include "tgfparser.h"
+#include "graphcache.h"
+#include "workpool.h"
+#include <unordered_map>
 
 namespace fs = std::filesystem;
 
-constexpr uint64_t seed1 = 1;
-constexpr uint64_t seed2 = 2;
-
 std::vector<std::string> get_graphlist()
 {
     std::vector<std::string> ret;
@@ -62,56 +64,148 @@ std::set<std::string> get_graphset()
 
 Graph* parseFile(std::string path)
 {
-    std::map<std::string, std::shared_ptr<Argument>> arglookup;
-    std::set<std::pair<std::string, std::string>> atts;
-    std::ifstream ifile(path);
-    std::string tokenbuff, secondbuff;
-    enum States : bool { arguments, attacks };
-    States state = arguments;
-
-    for (int ctr = 0; ifile >> tokenbuff; ctr++)
-    {   switch (state)
-        {   case arguments:
-                if (tokenbuff == "#") state = attacks;
-                else
-                {   auto insert = arglookup.insert(std::make_pair<std::string, std::shared_ptr<Argument>>(std::move(tokenbuff), std::make_shared<Argument>(tokenbuff, ctr)));
-                    if (!insert.second)
-                    {   std::cerr << "WARNING: Malformed tgf file: duplicate argument on line " << ctr << ". Ignoring." << std::endl;
+    std::unique_ptr<MappedFile> file;
+    try
+    {   file = std::make_unique<MappedFile>(path);
+    }
+    catch (std::system_error& e)
+    {   std::cerr << "ERROR: " << e.what() << std::endl;
+        return nullptr;
+    }
+
+    TgfContents contents;
+    if (!scanTgf(file->view(), path, contents))
+    {   return nullptr;
+    }
+
+    Graph* ret = new Graph(path);
+    size_t nameBytes = 0;
+    for (std::string_view name : contents.names)
+    {   nameBytes += name.size();
+    }
+    ret->reserve(contents.names.size(), nameBytes, contents.attacks.size());
+
+    std::vector<int32_t> index(contents.names.size(), -1);
+    for (size_t i = 0; i < contents.names.size(); i++)
+    {   if (contents.declared[i])
+        {   index[i] = ret->addArgument(contents.names[i]);
+        }
+    }
+    for (uint64_t att : contents.attacks)
+    {   int32_t src = index[att >> 32];
+        int32_t dest = index[att & 0xffffffff];
+        if (src < 0 || dest < 0)
+        {   std::cerr << "WARNING: Malformed tgf file " << path << ": attack " << contents.names[att >> 32] << " " << contents.names[att & 0xffffffff]
+                << " refers to an undeclared argument. Ignoring." << std::endl;
+            continue;
+        }
+        ret->addAttack(src, dest);
+    }
+    ret->buildIndex();
+    ret->setHash(tgfHash(contents));
+    return ret;
+}
+
+std::string hashFile(std::string path)
+{
+    std::unique_ptr<MappedFile> file;
+    try
+    {   file = std::make_unique<MappedFile>(path);
+    }
+    catch (std::system_error& e)
+    {   std::cerr << "ERROR: " << e.what() << std::endl;
+        return "";
+    }
+
+    TgfContents contents;
+    if (!scanTgf(file->view(), path, contents))
+    {   return "";
+    }
+    return tgfHash(contents);
+}
+
+Graph* loadGraph(std::string path, std::string knownHash)
+{
+    bool useCache = !opts["store-path"].empty() && !(opts.count("no-graph-cache") && opts["no-graph-cache"].as<bool>());
+    fs::path cacheDir(useCache? opts["store-path"].as<std::string>() + "/graph-cache/" : "");
+    if (useCache && !knownHash.empty())
+    {   std::unique_ptr<Graph> cached = readGraphSnapshot(cacheDir / knownHash, path, knownHash);
+        if (cached)
+        {   return cached.release();
+        }
+    }
+
+    Graph* ret = parseFile(path);
+    //(re)write the snapshot unless a valid one exists; if the hash was known, we just found it isn't
+    if (ret && useCache && (ret->hash() == knownHash || !fs::exists(cacheDir / ret->hash())))
+    {   std::error_code ec;
+        fs::create_directories(cacheDir, ec);
+        if (!writeGraphSnapshot(*ret, cacheDir / ret->hash()))
+        {   std::cerr << "WARNING: Unable to write graph cache entry " << (cacheDir / ret->hash()).string() << " for graph " << path << std::endl;
+        }
+    }
+    return ret;
+}
+
+std::vector<std::string> hashGraphs(const std::vector<std::string>& graphFiles, GraphHashSet& ghset, bool useHashCache, unsigned jobs, bool snapshot)
+{
+    std::vector<std::string> hashes(graphFiles.size());
+    WorkPool pool(jobs);
+    for (size_t i = 0; i < graphFiles.size(); i++)
+    {   pool.submit([&, i]()
+            {
+                const std::string& graphFile = graphFiles[i];
+                FileStamp stamp = FileStamp::of(graphFile); //before reading the file, so a change while it's hashed isn't missed
+                if (useHashCache)
+                {   hashes[i] = ghset.lookup(graphFile, stamp);
+                }
+                if (!hashes[i].empty())
+                {   return;
+                }
+                if (snapshot)
+                {   std::unique_ptr<Graph> graph(loadGraph(graphFile));
+                    if (graph)
+                    {   hashes[i] = graph->hash();
                     }
                 }
-                break;
-            case attacks:
-                if (!(ifile >> secondbuff))
-                {   std::cerr << "ERROR: Malformed tgf file: an attack is missing its destination" << std::endl;
-                    return nullptr;
+                else
+                {   hashes[i] = hashFile(graphFile); //only the hash is needed, so the graph itself is never built
                 }
-                std::pair<std::set<std::pair<std::string, std::string>>::iterator, bool> insert = atts.insert(std::make_pair(tokenbuff, secondbuff));
-                if (!insert.second)
-                {   std::cerr << "WARNING: Malformed tgf file: duplicate attack on line " << ctr << ". Ignoring." << std::endl;
+                if (hashes[i].empty())
+                {   ghset.remove(graphFile); //any cached hash is for an older version of the file
                 }
-                break;
-        }
+                else
+                {   ghset.setHash(graphFile, hashes[i], stamp);
+                }
+            });
     }
+    pool.run();
 
-    Graph* ret = new Graph(path);
-    SpookyHash graphHash;
-    graphHash.Init(seed1, seed2);
-
-    for (auto& arg : arglookup)
-    {   graphHash.Update(arg.first.c_str(), arg.first.length());
-        ret->addArgument(arg.second);
-    }
-    for (std::pair<std::string, std::string> att : atts)
-    {   graphHash.Update((att.first + att.second).c_str(), (att.first + att.second).length());
-        ret->addAttack(arglookup[att.first], arglookup[att.second]);
+    for (size_t i = 0; i < graphFiles.size(); i++)
+    {   if (hashes[i].empty())
+        {   std::cerr << "ERROR: Error parsing graph file: " << graphFiles[i] << ". Skipping." << std::endl;
+        }
     }
+    return hashes;
+}
 
-    uint64_t hash1;
-    uint64_t hash2;
-    graphHash.Final(&hash1, &hash2);
-    std::stringstream streamtmp;
-    streamtmp << std::hex << hash1 << hash2;
-    ret->setHash(streamtmp.str());
+std::vector<UniqueGraph> dedupeGraphs(const std::vector<std::string>& graphFiles, const std::vector<std::string>& hashes)
+{
+    std::vector<UniqueGraph> ret;
+    std::unordered_map<std::string, size_t> seen;
+    for (size_t i = 0; i < graphFiles.size(); i++)
+    {   if (hashes[i].empty())
+        {   continue;
+        }
+        auto found = seen.find(hashes[i]);
+        if (found == seen.end())
+        {   seen.emplace(hashes[i], ret.size());
+            ret.push_back(UniqueGraph { hashes[i], graphFiles[i], {} });
+        }
+        else
+        {   ret[found->second].duplicates.push_back(graphFiles[i]);
+        }
+    }
     return ret;
 }
 
@@ -0,0 +1,81 @@
+#include <thread>
+#include "workpool.h"
+
+WorkPool::WorkPool(unsigned threads)
+{
+    if (threads == 0)
+    {   threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threads; i++)
+    {   queues.push_back(std::make_unique<Queue>());
+    }
+}
+
+unsigned WorkPool::size() const
+{
+    return queues.size();
+}
+
+void WorkPool::submit(std::function<void()> task)
+{
+    Queue& q = *queues[nextQueue];
+    nextQueue = (nextQueue + 1) % queues.size();
+    std::lock_guard<std::mutex> guard(q.lock);
+    q.tasks.push_back(std::move(task));
+}
+
+bool WorkPool::take(unsigned worker, std::function<void()>& task)
+{
+    {   Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> guard(own.lock);
+        if (!own.tasks.empty())
+        {   task = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+    for (unsigned i = 1; i < queues.size(); i++)
+    {   Queue& victim = *queues[(worker + i) % queues.size()];
+        std::lock_guard<std::mutex> guard(victim.lock);
+        if (!victim.tasks.empty())
+        {   task = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+    return false; //nothing is ever added while running, so once every queue is empty we're done
+}
+
+void WorkPool::work(unsigned worker)
+{
+    std::function<void()> task;
+    while (take(worker, task))
+    {   try
+        {   task();
+        }
+        catch (...)
+        {   std::lock_guard<std::mutex> guard(errorLock);
+            if (!firstError)
+            {   firstError = std::current_exception();
+            }
+        }
+    }
+}
+
+void WorkPool::run()
+{
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < queues.size(); i++)
+    {   threads.emplace_back(&WorkPool::work, this, i);
+    }
+    work(0);
+    for (std::thread& t : threads)
+    {   t.join();
+    }
+
+    if (firstError)
+    {   std::exception_ptr err = firstError;
+        firstError = nullptr;
+        std::rethrow_exception(err);
+    }
+}
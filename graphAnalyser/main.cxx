@@ -11,6 +11,11 @@
 #include <fstream>
 #include <set>
 #include <unordered_set>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
 #include "graph.h"
 #include "metric.h"
 #include "opts.h"
@@ -21,6 +26,7 @@
 #include "_externalMetric.cxx"
 #include "graphhashset.h"
 #include "sccMetrics.cxx"
+#include "workpool.h"
 
 #ifndef CONF_PATH
     #define CONF_PATH "./analyser.coonf"
@@ -29,9 +35,210 @@
 namespace po = boost::program_options;
 namespace fs = std::filesystem;
 
-std::set<std::string> graphFiles;
+std::vector<std::string> graphFiles;
 std::vector<std::unique_ptr<Metric>> metrics;
 bool dry_run;
+bool forcecalc;
+bool clobber;
+bool quiet;
+bool verbose;
+bool useHashCache;
+unsigned metricJobs;
+
+//Output for a single graph. When several graphs are processed at once, it is held back and printed
+//in one go when the graph is done, so that the output of different graphs doesn't interleave.
+class GraphLog
+{
+    public:
+        GraphLog(bool buffered) : buffered(buffered) {
+        }
+        ~GraphLog()
+        {
+            if (buffered)
+            {   std::lock_guard<std::mutex> guard(consoleLock);
+                std::cout << outBuff.str() << std::flush;
+                std::cerr << errBuff.str() << std::flush;
+            }
+        }
+        std::ostream& out() { return buffered? outBuff : std::cout; }
+        std::ostream& err() { return buffered? errBuff : std::cerr; }
+    private:
+        static std::mutex consoleLock;
+        bool buffered;
+        std::ostringstream outBuff;
+        std::ostringstream errBuff;
+};
+std::mutex GraphLog::consoleLock;
+
+struct MetricResult
+{
+    MetricOutcome outcome;
+    double score;
+    std::string error; //set unless the outcome is OK
+};
+
+MetricResult runMetric(const Metric& m, AnalysisContext& context)
+{
+    MetricResult result { { MetricOutcome::OK, 0 }, 0, "" };
+    auto start = std::chrono::steady_clock::now();
+    try
+    {   result.score = m.calculate(context);
+    }
+    catch (MetricLimitExceeded& e)
+    {   result.outcome.status = e.status;
+        result.error = e.what();
+    }
+    catch (std::exception& e)
+    {   result.outcome.status = MetricOutcome::ERROR;
+        result.error = e.what();
+    }
+    result.outcome.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void recordResult(const Metric& m, const MetricResult& result, MetricSet& mset, GraphLog& log)
+{
+    //only failures are recorded, so that the score files of metrics that succeed (as built-in ones always do
+    //unless the graph can't be parsed) hold nothing but their scores
+    if (result.outcome.status == MetricOutcome::OK)
+    {   mset.clearOutcome(m.name);
+    }
+    else
+    {   mset.setOutcome(m.name, result.outcome);
+    }
+    switch (result.outcome.status)
+    {   case MetricOutcome::OK:
+            mset.setScore(m.name, result.score);
+            break;
+        case MetricOutcome::TIMEOUT:
+        case MetricOutcome::MEMOUT:
+            log.err() << "WARNING: Metric " << m.name << " was stopped after " << result.outcome.seconds << "s: " << result.error << ". Skipping this metric." << std::endl;
+            break;
+        case MetricOutcome::ERROR:
+            log.err() << "ERROR: Error calculating metric " << m.name << ": " << result.error << ". Skipping this metric." << std::endl;
+            break;
+    }
+}
+
+void processGraph(const UniqueGraph& graph, const fs::path& outDir, GraphLog& log)
+{
+    const std::string& graphFile = graph.path;
+    const std::string& currentHash = graph.hash;
+
+    if (!quiet) {
+        log.out() << "Starting to process graph " << graphFile << std::endl;
+    }
+    if (verbose)
+    {   for (const std::string& duplicate : graph.duplicates)
+        {   log.out() << "    " << duplicate << " is the same graph, so shares these results" << std::endl;
+        }
+    }
+
+    fs::path ofp = outDir / currentHash;
+    std::unique_ptr<MetricSet> mset_ptr;
+    try
+    {   mset_ptr = std::make_unique<MetricSet>(ofp);
+    }
+    catch (std::exception& e)
+    {   log.err() << "ERROR: Unable to load file of existing results: " << ofp.string() << " for graph: " << graphFile
+            << ". Skipping graph; please check permissions, or delete the file if you do not wish to keep the existing results, then re-run the "
+            << "analyser for this graph using the -g option." << std::endl;
+        return;
+    }
+    if (!mset_ptr)
+    {   log.err() << "DEBUG: This should never show up. mset_ptr is null despite having been constructed. Skipping graphs " << graphFile << std::endl;
+        return;
+    }
+    MetricSet& mset = *mset_ptr;
+
+    if (clobber)
+    {   mset.clear();
+    }
+
+    //work out which metrics still need calculating, then run them in dependency order, so each
+    //artefact (the parsed graph, SCCs etc.) is built once and freed as soon as nothing else needs it
+    std::vector<const Metric*> pending;
+    for (const auto& m : metrics)
+    {   if (mset.exists(m->name) && !forcecalc) //skip if already calculated
+        {   if (dry_run)
+            {   log.out() << "    (dry run) skipping metric " << m->name << " as it already exists and -f wasn't set" << std::endl;
+            }
+            continue;
+        }
+        pending.push_back(m.get());
+    }
+    scheduleMetrics(pending);
+
+    AnalysisContext context(graphFile, currentHash); //loaded lazily, normally from the snapshot left by hashing
+    auto next = pending.begin();
+
+    //metrics that don't need the parsed graph (i.e. external ones) only read the graph's path from the
+    //context, so several of them can run at once
+    auto graphFree = std::find_if(pending.begin(), pending.end(), [](const Metric* m) { return needsGraph(*m); }) - pending.begin();
+    if (!dry_run && metricJobs != 1 && graphFree > 1)
+    {   std::vector<MetricResult> results(graphFree);
+        WorkPool metricPool(metricJobs == 0? graphFree : std::min<unsigned>(metricJobs, graphFree));
+        for (int i = 0; i < graphFree; i++)
+        {   if (verbose)
+            {   log.out() << "    Running metric " << pending[i]->name << std::endl;
+            }
+            metricPool.submit([&results, &context, &pending, i]() { results[i] = runMetric(*pending[i], context); });
+        }
+        metricPool.run();
+        for (int i = 0; i < graphFree; i++)
+        {   recordResult(*pending[i], results[i], mset, log);
+        }
+        next += graphFree;
+    }
+
+    for (auto it = next; it != pending.end(); ++it)
+    {   const Metric* m = *it;
+        if (dry_run)
+        {   log.out() << "    (dry run) Would run metric " << m->name << " here" << std::endl;
+            if (needsGraph(*m) && !context.has(Artefact::ParsedGraph))
+            {   log.out() << "    (dry run) Would lazy load graph here" << std::endl;
+            }
+            continue;
+        }
+
+        if (needsGraph(*m) && !context.has(Artefact::ParsedGraph))
+        {   if (verbose)
+            {   log.out() << "    Lazy loading graph..." << std::endl;
+            }
+            try
+            {   context.graph();
+            }
+            catch (std::exception& e)
+            {   log.err() << "ERROR: Error parsing graph file: " << graphFile <<". Skipping." << std::endl;
+                break; //metrics that don't need the graph were scheduled first, so everything left needs it
+            }
+        }
+        if (verbose)
+        {   log.out() << "    Running metric " << m->name << std::endl;
+        }
+        recordResult(*m, runMetric(*m, context), mset, log);
+        releaseUnneeded(context, it + 1, pending.end());
+    }
+
+    //we're done with the graph
+    //also the breakout point if lazy loading a graph fails
+    //delete graphPtr;
+
+    //finally save the output
+    if (dry_run)
+    {   log.out() << "DRY RUN: Finished processing graph. Would write results to " << ofp.string() << "." << std::endl << std::endl;
+    }
+    else
+    {   try
+        {   mset.save();
+        }
+        catch (std::exception& e)
+        {   log.err() << "ERROR: Failure trying to write output file " << ofp.string() << " for graph " << graphFile << ". Exception message:" << std::endl;
+            log.err() << e.what() << std::endl;
+            log.err() << "Skipping graph!" << std::endl;
+        }
+    }
+}
 
 int main(int argc, char** argv)
 {
@@ -56,7 +263,12 @@ int main(int argc, char** argv)
         ("clobber,C", po::bool_switch(), "When an existing results file is found for a given graph, truncate it before writing the new results.\nThis is useful if some metric has been deprecated and is not used anymore, but still clogs up the results files.\n")
         ("metric-whitelist,w", po::value<std::vector<std::string>>()->multitoken()->composing(), "A whitelist of metrics to use. Only these will be used to process the graph, all others will be skipped.\n")
         ("metric-blacklist,b", po::value<std::vector<std::string>>()->multitoken()->composing(), "A blacklist of metrics to disable. These metrics will not be ran.\nTakes precedence over the whitelist: a metric present in both options will not be ran.\n")
+        ("metric-time-limit", po::value<double>(), "Wall clock time limit (in seconds) for each external metric on each graph. A metric exceeding it is killed, and its outcome recorded as TIMEOUT.\n")
+        ("metric-cpu-limit", po::value<double>(), "CPU time limit (in seconds) for each external metric on each graph, counting any processes it starts. A metric exceeding it is killed, and its outcome recorded as TIMEOUT.\n")
+        ("metric-memory-limit", po::value<size_t>(), "Memory limit (in megabytes) for each external metric, counting any processes it starts. A metric exceeding it is killed, and its outcome recorded as MEMOUT.\n")
+        ("metric-jobs", po::value<unsigned>()->default_value(1), "Number of metrics not needing the parsed graph (i.e. external metrics) to run in parallel on each graph. 0 runs all of them at once.\n")
         ("dry-run", po::bool_switch(), "Without doing any actual calculations, print out a list of graphs that would be used, and for every graph, which metrics would be ran.\n");
+    addJobsOpts(allSrcs, "graphs");
     addQuietVerboseOpts(allSrcs);
 
     po::options_description cmdOpts;
@@ -101,6 +313,16 @@ int main(int argc, char** argv)
     }
 
     /******** Construct external metrics ********/
+    ResourceLimits limits;
+    if (!opts["metric-time-limit"].empty())
+    {   limits.wallSeconds = opts["metric-time-limit"].as<double>();
+    }
+    if (!opts["metric-cpu-limit"].empty())
+    {   limits.cpuSeconds = opts["metric-cpu-limit"].as<double>();
+    }
+    if (!opts["metric-memory-limit"].empty())
+    {   limits.memoryMB = opts["metric-memory-limit"].as<size_t>();
+    }
     fs::perms any_exec = fs::perms::owner_exec | fs::perms::group_exec | fs::perms::others_exec;
     fs::path extmetricp(opts["store-path"].as<std::string>() + "/external-metrics");
     if (fs::is_directory(extmetricp))
@@ -111,7 +333,8 @@ int main(int argc, char** argv)
             fs::perms permissions = dirent.status().permissions();
             if ((permissions & any_exec) != fs::perms::none) //is executable
             {   fs::path path = dirent.path();
-                metrics.push_back(std::make_unique<ExternalMetric>(path.stem(), path.string())); //metric name is just filename w/o extension
+                bool batch = fs::exists(extmetricp / (path.stem().string() + ".batch")); //marker file opting in to the long-lived protocol
+                metrics.push_back(std::make_unique<ExternalMetric>(path.stem(), path.string(), batch, limits)); //metric name is just filename w/o extension
             }
         }
     }
@@ -174,7 +397,7 @@ int main(int argc, char** argv)
 
 
     /******** Construct list of graphs ********/
-    graphFiles = get_graphset();
+    graphFiles = get_graphlist();
 
     /******** Loop over graphs: parse graph, run metrics, save results ********/
 
@@ -190,122 +413,39 @@ int main(int argc, char** argv)
     {   fs::create_directory(outDir);
     }
 
-    bool forcecalc = opts["force-recalculate"].as<bool>(); //for ease of access
-    bool clobber = opts["clobber"].as<bool>();
-    bool quiet = opts["quiet"].as<bool>();
-    bool verbose = opts["verbose"].as<bool>();
-    bool useHashCache = opts["use-hash-cache"].as<bool>();
+    forcecalc = opts["force-recalculate"].as<bool>(); //for ease of access
+    clobber = opts["clobber"].as<bool>();
+    quiet = opts["quiet"].as<bool>();
+    verbose = opts["verbose"].as<bool>();
+    useHashCache = !opts["no-hash-cache"].as<bool>();
+    metricJobs = opts["metric-jobs"].as<unsigned>();
+
+    /******** Hash every graph up front, so each distinct one is only analysed once ********/
+    GraphHashSet ghset(opts["use-hash-cache"].as<bool>());
+    std::sort(graphFiles.begin(), graphFiles.end());
+    graphFiles.erase(std::unique(graphFiles.begin(), graphFiles.end()), graphFiles.end());
+    std::vector<std::string> hashes = hashGraphs(graphFiles, ghset, useHashCache, opts["jobs"].as<unsigned>(), !dry_run);
+    ghset.save();
+    std::vector<UniqueGraph> uniqueGraphs = dedupeGraphs(graphFiles, hashes);
+    size_t duplicateCount = 0;
+    for (const UniqueGraph& g : uniqueGraphs)
+    {   duplicateCount += g.duplicates.size();
+    }
+    if (duplicateCount > 0 && !quiet)
+    {   std::cout << "INFO: " << uniqueGraphs.size() + duplicateCount << " graph files hold " << uniqueGraphs.size() << " distinct graphs: "
+            << duplicateCount << " duplicate file(s) will not be analysed again. Use -V to see which." << std::endl;
+    }
 
-    GraphHashSet ghset;
+    WorkPool pool(opts["jobs"].as<unsigned>());
+    bool buffered = pool.size() > 1;
 
     //loop over graphs
-    for (std::string graphFile : graphFiles)
-    {   std::string currentHash;
-        std::unique_ptr<Graph> graphPtr;
-
-        if (!quiet) {
-            std::cout << "Starting to process graph " << graphFile << std::endl;
-        }
-
-        if (useHashCache && ghset.exists(graphFile))
-        {   currentHash = ghset.getHash(graphFile);
-        }
-        else
-        {   graphPtr = std::unique_ptr<Graph>(parseFile(graphFile));
-            if (!graphPtr)
-            {   std::cerr << "ERROR: Error parsing graph file: " << graphFile <<". Skipping." << std::endl;
-                continue;
-            }
-
-            currentHash = graphPtr->hash();
-            if (verbose)
-            {   std::cout << "Successfully loaded graph " << graphFile << std::endl;
-            }
-            ghset.setHash(graphFile, currentHash);
-        }
-
-        fs::path ofp = outDir / currentHash;
-
-        std::unique_ptr<MetricSet> mset_ptr;
-        try
-        {   mset_ptr = std::make_unique<MetricSet>(ofp);
-        }
-        catch (std::exception& e)
-        {   std::cerr << "ERROR: Unable to load file of existing results: " << ofp.string() << " for graph: " << graphFile
-                << ". Skipping graph; please check permissions, or delete the file if you do not wish to keep the existing results, then re-run the "
-                << "analyser for this graph using the -g option." << std::endl;
-            continue;
-        }
-        if (!mset_ptr)
-        {   std::cerr << "DEBUG: This should never show up. mset_ptr is null despite having been constructed. Skipping graphs " << graphFile << std::endl;
-            continue;
-        }
-        MetricSet& mset = *mset_ptr;
-
-        if (clobber)
-        {   mset.clear();
-        }
-
-        //actually do the calculations for every metric
-        for (const auto& m : metrics)
-        {   if (mset.exists(m->name) && !forcecalc) //skip if already calculated
-            {   if (dry_run)
-                {   std::cout << "    (dry run) skipping metric " << m->name << " as it already exists and -f wasn't set" << std::endl;
-                }
-                continue;
-            }
-
-            if (dry_run)
-            {   std::cout << "    (dry run) Would run metric " << m->name << " here" << std::endl;
-                if (!graphPtr)
-                {   std::cout << "    (dry run) Would lazy load graph here" << std::endl;
-                }
-            }
-            else
-            {   if (!graphPtr)
-                {   if (verbose)
-                    {   std::cout << "    Lazy loading graph..." << std::endl;
-                    }
-                    graphPtr = std::unique_ptr<Graph>(parseFile(graphFile));
-                    if (!graphPtr) {
-                        std::cerr << "ERROR: Error parsing graph file: " << graphFile <<". Skipping." << std::endl;
-                        break; //break out of the metric looping, since we can't load the graph
-                    }
-                }
-                if (verbose)
-                {   std::cout << "    Running metric " << m->name << std::endl;
-                }
-                try
-                {   double score = m->calculate(*graphPtr);
-                    mset.setScore(m->name, score);
-                }
-                catch (std::exception& e)
-                {   std::cerr << "ERROR: Error calculating metric " << m->name << ": " << e.what() << ". Skipping this metric." << std::endl;
-                }
-            }
-        }
-
-        //we're done with the graph
-        //also the breakout point if lazy loading a graph fails
-        //delete graphPtr;
-
-        //finally save the output
-        if (dry_run)
-        {   std::cout << "DRY RUN: Finished processing graph. Would write results to " << ofp.string() << "." << std::endl << std::endl;
-        }
-        else
-        {   try
-            {   mset.save();
-            }
-            catch (std::exception& e)
-            {   std::cerr << "ERROR: Failure trying to write output file " << ofp.string() << " for graph " << graphFile << ". Exception message:" << std::endl;
-                std::cerr << e.what() << std::endl;
-                std::cerr << "Skipping graph!" << std::endl;
-            }
-        }
+    for (const UniqueGraph& graph : uniqueGraphs)
+    {   pool.submit([&]()
+            {
+                GraphLog log(buffered);
+                processGraph(graph, outDir, log);
+            });
     }
-
-    /******** Finally save the hash cache ********/
-    ghset.save();
+    pool.run();
 }
-
@@ -1,34 +1,95 @@
 #include <exception>
 #include <stdexcept>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <sys/wait.h>
 #include "metric.h"
-#include "pstream.h"
+#include "subprocess.h"
 
 namespace fs = std::filesystem;
 
+//Runs an executable from store/external-metrics. By default it is started once per graph with the
+//graph's path as its only argument. A batch mode metric (one with a <name>.batch marker file next to
+//it) is instead started once as "<binary> --batch", and then repeatedly sent a graph path on a line of
+//its stdin, to which it answers with the score on a line of its stdout.
+//Either way the limits apply to each graph, and a metric exceeding them is killed.
 class ExternalMetric : public Metric {
     public:
-        ExternalMetric(std::string name, std::string binPath) : Metric(name), binPath(binPath) {
+        ExternalMetric(std::string name, std::string binPath, bool batch = false, ResourceLimits limits = {}) : Metric(name), binPath(binPath), batch(batch), limits(limits) {
         }
 
-        double calculate(const Graph& graph) const {
-            std::string arg = graph.fname();
-            std::vector<std::string> argv {binPath, arg};
-            redi::ipstream in(binPath, argv);
+        double calculate(AnalysisContext& context) const {
+            std::string arg = context.path(); //the graph is never parsed for external metrics
+            if (batch)
+            {   return calculateBatch(arg);
+            }
 
+            Subprocess proc(std::vector<std::string> {binPath, arg}, limits);
             std::string out;
-            std::getline(in, out);
-            in.close();
-            int err, status;
-            if ((err = in.rdbuf()->error()) == 0 && in.rdbuf()->exited()) {
-                status = in.rdbuf()->status();
-            } else {
-                throw std::runtime_error("Error executing external metric " + err);
-            }
-            if (status != 0) {
-                throw std::logic_error("Metric binary exited with non-zero status: " + status);
-            }
-            return std::stod(out);
+            bool finished = proc.readToEnd(out);
+            int status = proc.wait();
+            if (!finished)
+            {   throwLimitExceeded(proc);
+            }
+            if (WIFSIGNALED(status)) {
+                throw std::logic_error("Metric binary was killed by signal " + std::to_string(WTERMSIG(status)));
+            }
+            if (WEXITSTATUS(status) != 0) {
+                throw std::logic_error("Metric binary exited with non-zero status: " + std::to_string(WEXITSTATUS(status)));
+            }
+            return std::stod(out.substr(0, out.find('\n')));
         };
     private:
+        static void throwLimitExceeded(const Subprocess& proc) {
+            switch (proc.limitHit())
+            {   case Subprocess::WALL_TIME: throw MetricLimitExceeded(MetricOutcome::TIMEOUT, "wall time limit exceeded");
+                case Subprocess::CPU_TIME: throw MetricLimitExceeded(MetricOutcome::TIMEOUT, "CPU time limit exceeded");
+                case Subprocess::MEMORY: throw MetricLimitExceeded(MetricOutcome::MEMOUT, "memory limit exceeded");
+                default: throw std::runtime_error("metric output could not be read");
+            }
+        }
+
+        double calculateBatch(const std::string& graphPath) const {
+            if (graphPath.find('\n') != std::string::npos)
+            {   throw std::runtime_error("graph paths containing newlines can't be sent to batch mode metrics");
+            }
+
+            //take an idle worker, or start a new one if they're all busy with other graphs
+            std::unique_ptr<Subprocess> worker;
+            {   std::lock_guard<std::mutex> guard(idleLock);
+                if (!idle.empty())
+                {   worker = std::move(idle.back());
+                    idle.pop_back();
+                }
+            }
+            if (!worker)
+            {   worker = std::make_unique<Subprocess>(std::vector<std::string> { binPath, "--batch" }, limits);
+            }
+
+            std::string out;
+            worker->startClock();
+            if (!worker->writeLine(graphPath) || !worker->readLine(out))
+            {   if (worker->limitHit() != Subprocess::NONE)
+                {   throwLimitExceeded(*worker); //the killed worker is dropped here
+                }
+                throw std::runtime_error("batch mode metric exited without answering"); //the dead worker is dropped here
+            }
+
+            {   std::lock_guard<std::mutex> guard(idleLock);
+                idle.push_back(std::move(worker));
+            }
+            try
+            {   return std::stod(out);
+            }
+            catch (std::exception& e)
+            {   throw std::runtime_error("batch mode metric answered with something other than a score: " + out);
+            }
+        }
+
         std::string binPath;
+        bool batch;
+        ResourceLimits limits;
+        mutable std::mutex idleLock;
+        mutable std::vector<std::unique_ptr<Subprocess>> idle; //destroying one closes its stdin, telling it to exit
 };
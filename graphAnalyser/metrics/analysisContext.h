@@ -0,0 +1,94 @@
+#ifndef ANALYSISCONTEXT_H
+#define ANALYSISCONTEXT_H
+
+#include <vector>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include "graph.h"
+#include "util.h"
+#include "scc.h"
+
+//Derived structures metrics can ask for. Listed in dependency order: each one is only built from the ones before it.
+enum class Artefact { ParsedGraph, SCCs };
+constexpr int artefactCount = 2;
+
+inline std::vector<Artefact> artefactDependencies(Artefact a)
+{
+    switch (a)
+    {   case Artefact::SCCs:
+            return { Artefact::ParsedGraph };
+        default:
+            return {};
+    }
+}
+
+//Marks the given artefacts and everything they depend on
+inline void artefactClosure(const std::vector<Artefact>& needs, std::vector<bool>& closure)
+{
+    for (Artefact a : needs)
+    {   if (!closure[(int)a])
+        {   closure[(int)a] = true;
+            artefactClosure(artefactDependencies(a), closure);
+        }
+    }
+}
+
+//Everything known about one graph while its metrics are calculated. Artefacts are built on first use
+//and then shared by every metric that needs them; release() frees one once no remaining metric does.
+class AnalysisContext
+{
+    public:
+        AnalysisContext(std::string path, std::string hash, std::unique_ptr<Graph> graph = nullptr) : graphPath(path), graphHash(hash), parsedGraph(std::move(graph)) {
+        }
+        const std::string& path() const { return graphPath; }
+
+        bool has(Artefact a) const
+        {
+            switch (a)
+            {   case Artefact::ParsedGraph: return (bool)parsedGraph;
+                case Artefact::SCCs: return (bool)sccDecomposition;
+            }
+            return false;
+        }
+
+        //throws std::runtime_error if the graph file can't be parsed
+        const Graph& graph()
+        {
+            if (!parsedGraph)
+            {   if (parseFailed)
+                {   throw std::runtime_error("graph file could not be parsed");
+                }
+                parsedGraph = std::unique_ptr<Graph>(loadGraph(graphPath, graphHash)); //from the graph cache if possible
+                if (!parsedGraph)
+                {   parseFailed = true;
+                    throw std::runtime_error("graph file could not be parsed");
+                }
+            }
+            return *parsedGraph;
+        }
+
+        const SCCDecomposition& sccs()
+        {
+            if (!sccDecomposition)
+            {   sccDecomposition = std::make_unique<SCCDecomposition>(graph());
+            }
+            return *sccDecomposition;
+        }
+
+        void release(Artefact a)
+        {
+            switch (a)
+            {   case Artefact::ParsedGraph: parsedGraph.reset(); break;
+                case Artefact::SCCs: sccDecomposition.reset(); break;
+            }
+        }
+    private:
+        std::string graphPath;
+        std::string graphHash;
+        bool parseFailed = false;
+        std::unique_ptr<Graph> parsedGraph;
+        std::unique_ptr<SCCDecomposition> sccDecomposition;
+};
+
+#endif
@@ -2,14 +2,66 @@
 #define METRIC_H
 
 #include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 #include "graph.h"
+#include "metricset.h"
+#include "analysisContext.h"
 
 class Metric {
     public:
-        Metric(std::string name) : name(name) {
+        Metric(std::string name, std::vector<Artefact> needs = {}) : name(name), needs(needs) {
         }
         virtual ~Metric() {}
-        virtual double calculate(const Graph& graph) const = 0;
+        virtual double calculate(AnalysisContext& context) const = 0;
         const std::string name;
+        const std::vector<Artefact> needs; //artefacts calculate() will ask the context for
 };
+
+//Thrown by calculate() when the metric was stopped for exceeding its resource limits
+class MetricLimitExceeded : public std::runtime_error {
+    public:
+        MetricLimitExceeded(MetricOutcome::Status status, std::string what) : std::runtime_error(what), status(status) {
+        }
+        const MetricOutcome::Status status; //TIMEOUT or MEMOUT
+};
+
+//Orders metrics so that those sharing artefacts run back to back, cheapest dependencies first:
+//metrics needing nothing (i.e. not even the parsed graph), then by the last artefact (in dependency
+//order) they need. Otherwise the given order is kept.
+inline void scheduleMetrics(std::vector<const Metric*>& metrics)
+{
+    auto deepest = [](const Metric* m)
+    {
+        std::vector<bool> closure(artefactCount, false);
+        artefactClosure(m->needs, closure);
+        int last = -1;
+        for (int a = 0; a < artefactCount; a++)
+        {   if (closure[a]) last = a;
+        }
+        return last;
+    };
+    std::stable_sort(metrics.begin(), metrics.end(), [&deepest](const Metric* a, const Metric* b) { return deepest(a) < deepest(b); });
+}
+
+//Frees every artefact none of the given (remaining) metrics needs
+template <typename It>
+void releaseUnneeded(AnalysisContext& context, It first, It last)
+{
+    std::vector<bool> closure(artefactCount, false);
+    for (It it = first; it != last; ++it)
+    {   artefactClosure((*it)->needs, closure);
+    }
+    for (int a = 0; a < artefactCount; a++)
+    {   if (!closure[a])
+        {   context.release((Artefact)a);
+        }
+    }
+}
+
+inline bool needsGraph(const Metric& m)
+{
+    return !m.needs.empty(); //every artefact is derived from the parsed graph
+}
 #endif
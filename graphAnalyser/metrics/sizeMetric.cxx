@@ -2,9 +2,9 @@
 
 class SizeMetric : public Metric {
     public:
-        SizeMetric() :Metric("Size") {
+        SizeMetric() :Metric("Size", { Artefact::ParsedGraph }) {
         }
-        double calculate(const Graph& graph) const {
-            return graph.size();
+        double calculate(AnalysisContext& context) const {
+            return context.graph().size();
         };
 };
@@ -2,11 +2,12 @@
 
 class SparsenessMetric : public Metric {
     public:
-        SparsenessMetric() :Metric("Sparseness") {
+        SparsenessMetric() :Metric("Sparseness", { Artefact::ParsedGraph }) {
         }
-        double calculate(const Graph& graph) const {
-            int argCount = graph.getArgs().size();
-            double attCount = graph.getAttacks().size(); //has to be a double to avoid rounding during calculation
+        double calculate(AnalysisContext& context) const {
+            const Graph& graph = context.graph();
+            int argCount = graph.argCount();
+            double attCount = graph.attackCount(); //has to be a double to avoid rounding during calculation
             return attCount / (argCount * argCount);
         };
 };
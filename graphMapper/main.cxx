@@ -10,9 +10,13 @@
 #include <unordered_map>
 #include <algorithm>
 #include <iomanip>
+#include <memory>
+#include <string_view>
 #include "util.h"
 #include "graph.h"
 #include "opts.h"
+#include "graphhashset.h"
+#include "graphhashindex.h"
 
 #ifndef CONF_PATH
     #define CONF_PATH "./mapper.coonf"
@@ -21,6 +25,66 @@
 namespace po = boost::program_options;
 namespace fs = std::filesystem;
 
+void printDuplicates(const std::vector<std::pair<std::string_view, std::vector<std::string_view>>>& groups)
+{
+    for (auto& group : groups)
+    {   std::cout << group.first;
+        for (std::string_view path : group.second)
+        {   std::cout << " " << path;
+        }
+        std::cout << std::endl; //format: "hashvalue graphname graphname..." (space-separated, one hash per line)
+    }
+}
+
+int answerFromIndex(bool listHashes, bool searchHashes, bool duplicates)
+{
+    fs::path indexFile(opts["store-path"].as<std::string>() + "/graphhashindex");
+    std::unique_ptr<GraphHashIndex> index;
+    try
+    {   index = std::make_unique<GraphHashIndex>(indexFile);
+    }
+    catch (std::exception& e)
+    {   std::cerr << "ERROR: Unable to use the hash index: " << e.what() << ". Run graph_mapper without --use-index to rebuild it." << std::endl;
+        return 1;
+    }
+
+    bool separate = false;
+    if (listHashes)
+    {   std::vector<std::string> graphFiles = get_graphlist();
+        unsigned long maxfnamelen = 0;
+        for (const std::string& graphFile : graphFiles)
+        {   maxfnamelen = std::max(maxfnamelen, graphFile.length());
+        }
+        for (const std::string& graphFile : graphFiles)
+        {   std::string_view hash = index->hashOf(graphFile);
+            if (hash.empty())
+            {   std::cerr << "WARNING: " << graphFile << " is not in the hash index. Skipping." << std::endl;
+                continue;
+            }
+            std::cout << std::left << std::setw(maxfnamelen + 1) << graphFile << " " << hash << std::endl;
+        }
+        separate = true;
+    }
+    if (searchHashes)
+    {   if (separate)
+        {   std::cout << "### Lookup results" << std::endl;
+        }
+        for (std::string search : opts["hash-lookup"].as<std::vector<std::string>>())
+        {   for (std::string_view path : index->pathsOf(search))
+            {   std::cout << search << " " << path << std::endl;
+            }
+        }
+        separate = true;
+    }
+    if (duplicates)
+    {   if (separate)
+        {   std::cout << "### Duplicates" << std::endl;
+        }
+        printDuplicates(index->duplicates());
+    }
+    return 0;
+}
+
 int main(int argc, char** argv)
 {
     /******** Define configuration options ********/
@@ -30,9 +94,12 @@ int main(int argc, char** argv)
     po::options_description allSrcs("All configuration");
     allSrcs.add_options()
         ("hash-lookup,l", po::value<std::vector<std::string>>()->multitoken()->composing(), "List of file hashes to look up the source file of, out of the input files. Disables listing the hashes of the input files.")
-        ("force-list-hashes,f", po::bool_switch(), "Forces listing the hashes of the input files, even if --hash-lookup is also specified.");
+        ("force-list-hashes,f", po::bool_switch(), "Forces listing the hashes of the input files, even if --hash-lookup is also specified.")
+        ("duplicates,D", po::bool_switch(), "List every hash shared by more than one file, with the files sharing it.")
+        ("use-index,x", po::bool_switch(), "Answer from the store's hash index alone, without reading (or even checking) any graph file. Lookups and --duplicates then cover every graph hashed by any tool into this store, rather than just the input files, as of the last time they were hashed.");
         //("pretty-print,p", po::bool_switch(), "Pads out the output into nice columns");
     addGraphFileOpts(allSrcs);
+    addJobsOpts(allSrcs, "graph files");
 
     po::options_description cmdOpts;
     cmdOpts.add(cmdOnly).add(allSrcs);
@@ -66,38 +133,45 @@ int main(int argc, char** argv)
         return 0;
     }
 
-    std::vector<std::string> graphFiles = get_graphlist();
-    std::unordered_multimap<std::string, std::string> graphHashes;
-
     bool searchHashes = false;
     bool listHashes = true;
-    if (!opts["hash-lookup"].empty())
-    {   searchHashes = true;
+    bool duplicates = opts["duplicates"].as<bool>();
+    if (!opts["hash-lookup"].empty() || duplicates)
+    {   searchHashes = !opts["hash-lookup"].empty();
         listHashes = false;
         if (opts["force-list-hashes"].as<bool>())
         {   listHashes = true;
         }
     }
 
+    if (opts["use-index"].as<bool>())
+    {   return answerFromIndex(listHashes, searchHashes, duplicates);
+    }
+
+    std::vector<std::string> graphFiles = get_graphlist();
+    std::unordered_multimap<std::string, std::string> graphHashes;
+
+    //hash every file, in parallel, reusing cached hashes of unchanged files
+    GraphHashSet ghset(opts["use-hash-cache"].as<bool>());
+    std::vector<std::string> hashes = hashGraphs(graphFiles, ghset, !opts["no-hash-cache"].as<bool>(), opts["jobs"].as<unsigned>());
+    ghset.save();
+
     unsigned long maxfnamelen = 0;
-    if (!graphFiles.empty())
-    {   for (std::string graphFile : graphFiles)
-        {   if (graphFile.length() > maxfnamelen)
-            {   maxfnamelen = graphFile.length();
-            }
-            Graph* graphPtr = parseFile(graphFile);
-            if (!graphPtr)
-            {   std::cerr << "ERROR: Error parsing graph file: " << graphFile <<". Skipping." << std::endl;
-                continue;
-            }
-            graphHashes.insert(std::make_pair<std::string, std::string>(graphPtr->hash(), std::move(graphFile)));
-            delete graphPtr;
+    for (size_t i = 0; i < graphFiles.size(); i++)
+    {   if (graphFiles[i].length() > maxfnamelen)
+        {   maxfnamelen = graphFiles[i].length();
         }
+        if (hashes[i].empty())
+        {   continue;
+        }
+        graphHashes.insert(std::make_pair(hashes[i], graphFiles[i]));
     }
 
     if (listHashes)
-    {   for (auto& entry : graphHashes)
-        {   std::cout << std::left << std::setw(maxfnamelen + 1) << entry.second << " " << entry.first << std::endl; //format: "graphname hashvalue" (space-sparated, one per line)
+    {   for (size_t i = 0; i < graphFiles.size(); i++) //in input order
+        {   if (!hashes[i].empty())
+            {   std::cout << std::left << std::setw(maxfnamelen + 1) << graphFiles[i] << " " << hashes[i] << std::endl; //format: "graphname hashvalue" (space-sparated, one per line)
+            }
         }
     }
     if (searchHashes)
@@ -113,5 +187,27 @@ int main(int argc, char** argv)
                 });
         }
     }
+    if (duplicates)
+    {   if (listHashes || searchHashes)
+        {   std::cout << "### Duplicates" << std::endl;
+        }
+        std::vector<std::pair<std::string_view, std::string_view>> byHash;
+        for (size_t i = 0; i < graphFiles.size(); i++)
+        {   if (!hashes[i].empty())
+            {   byHash.emplace_back(hashes[i], graphFiles[i]);
+            }
+        }
+        std::sort(byHash.begin(), byHash.end());
+        std::vector<std::pair<std::string_view, std::vector<std::string_view>>> groups;
+        for (size_t i = 0; i < byHash.size(); i++)
+        {   if (i + 1 < byHash.size() && byHash[i + 1].first == byHash[i].first && (groups.empty() || groups.back().first != byHash[i].first))
+            {   groups.emplace_back(byHash[i].first, std::vector<std::string_view>());
+            }
+            if (!groups.empty() && groups.back().first == byHash[i].first)
+            {   groups.back().second.push_back(byHash[i].second);
+            }
+        }
+        printDuplicates(groups);
+    }
 }
 